@@ -3,25 +3,42 @@
 #include <stddef.h>
 #include <sys/event.h>
 #include <sys/time.h>
-#include <unordered_map>
+#include <stdint.h>
+#include <vector>
 
 namespace libasync
-{   //Kqueue event buffer size
-    static const size_t KEVENT_BUFFER_SIZE = 64;
-    //Zero time object
+{   //Zero time object
     static const timespec zero_time = {.tv_sec = 0, .tv_nsec = 0};
+    //Identifier of wakeup user event
+    static const uintptr_t KQUEUE_WAKEUP_IDENT = 0;
+
+    //Lookup table entry type
+    struct KqueueEntry
+    {   //Reactor target
+        ReactorTarget* target;
+        //Registration generation
+        uint32_t generation;
+    };
 
     //Kqueue data type
     struct KqueueData
     {   //Kqueue file descriptor
         int fd;
-        //Kqueue events buffer
-        struct kevent events[KEVENT_BUFFER_SIZE];
+        //Kqueue events buffer (Sized to current event batch)
+        std::vector<struct kevent> events;
 
-        //Reverse lookup table
-        std::unordered_map<int, ReactorTarget*> table;
+        //Reverse lookup table (Indexed by file descriptor)
+        std::vector<KqueueEntry> table;
+        //Registration generation counter
+        uint32_t generation;
+        //Unregistered targets (Released after dispatching events)
+        std::vector<ReactorTarget*> garbage;
     };
 
     //Kqueue data
     extern thread_local KqueueData* kqueue_data;
+
+    //Add reactor target to lookup table
+    //(Returns kevent user data identifying this registration)
+    void* kqueue_table_add(int fd, ReactorTarget* target);
 }
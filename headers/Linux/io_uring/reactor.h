@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+#include <vector>
+
+namespace libasync
+{   //Submission queue size
+    static const unsigned URING_QUEUE_SIZE = 256;
+    //Provided buffer amount (Must be power of 2)
+    static const unsigned URING_N_BUFFERS = 256;
+    //Provided buffer size
+    static const size_t URING_BUFFER_SIZE = 4096;
+    //Provided buffer group ID
+    static const uint16_t URING_BUFFER_GROUP = 0;
+
+    //Operation type (Stored in lower bits of user data)
+    enum UringOp : uint64_t
+    {   URING_OP_READ = 1,
+        URING_OP_WRITE = 2,
+        URING_OP_CONNECT = 3,
+        URING_OP_ACCEPT = 4,
+        URING_OP_WAKEUP = 5,
+        URING_OP_POLL = 6
+    };
+    //Operation type mask
+    static const uint64_t URING_OP_MASK = 7;
+
+    //io_uring data type
+    struct UringData
+    {   //io_uring file descriptor
+        int fd;
+
+        //Submission queue head
+        unsigned* sq_head;
+        //Submission queue tail
+        unsigned* sq_tail;
+        //Submission queue mask
+        unsigned sq_mask;
+        //Submission queue entries amount
+        unsigned sq_entries;
+        //Submission queue index array
+        unsigned* sq_array;
+        //Submission queue entries
+        io_uring_sqe* sqes;
+        //Entries not yet submitted to kernel
+        unsigned n_unsubmitted;
+
+        //Completion queue head
+        unsigned* cq_head;
+        //Completion queue tail
+        unsigned* cq_tail;
+        //Completion queue mask
+        unsigned cq_mask;
+        //Completion queue entries
+        io_uring_cqe* cqes;
+
+        //Mapped submission queue ring
+        void* sq_ring;
+        size_t sq_ring_size;
+        //Mapped completion queue ring
+        void* cq_ring;
+        size_t cq_ring_size;
+
+        //Wakeup event descriptor (Signalled by posting threads)
+        int wakeup_fd;
+        //Wakeup event counter read buffer
+        uint64_t wakeup_value;
+
+        //Provided buffer ring
+        //(Not accessed through "io_uring_buf_ring", whose layout differs in C++)
+        io_uring_buf* buf_ring;
+        //Provided buffers
+        char* buffers;
+
+        //Reverse lookup table (Indexed by file descriptor)
+        //(Operations in flight are counted by targets themselves)
+        std::vector<ReactorTarget*> table;
+    };
+
+    //io_uring data
+    extern thread_local UringData* uring_data;
+
+    //Add reactor target to lookup table
+    void uring_table_add(int fd, ReactorTarget* target);
+    //Get a submission queue entry for an operation on given file descriptor
+    io_uring_sqe* uring_prep(int fd, uint64_t op);
+    //Submit queued entries to kernel
+    void uring_submit();
+    //Get provided buffer by buffer ID
+    char* uring_buffer(uint16_t bid);
+}
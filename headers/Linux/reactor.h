@@ -1,24 +1,51 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/epoll.h>
-#include <unordered_map>
+#include <vector>
 
 namespace libasync
-{   //Epoll event buffer size
-    static const size_t EPOLL_EVENT_BUFFER_SIZE = 64;
+{   //Epoll event data of wakeup event descriptor
+    static const uint64_t EPOLL_WAKEUP_DATA = UINT64_MAX;
+
+    //Lookup table entry type
+    struct EpollEntry
+    {   //Reactor target
+        ReactorTarget* target;
+        //Registration generation
+        uint32_t generation;
+        //Waiting to be served again
+        bool requeued;
+    };
 
     //Epoll data type
     struct EpollData
     {   //Epoll file descriptor
         int fd;
-        //Epoll events buffer
-        epoll_event events[EPOLL_EVENT_BUFFER_SIZE];
+        //Wakeup event descriptor (Signalled by posting threads)
+        int wakeup_fd;
+        //Epoll events buffer (Sized to current event batch)
+        std::vector<epoll_event> events;
 
-        //Reverse lookup table
-        std::unordered_map<int, ReactorTarget*> table;
+        //Reverse lookup table (Indexed by file descriptor)
+        std::vector<EpollEntry> table;
+        //Registration generation counter
+        uint32_t generation;
+        //Unregistered targets (Released after dispatching events)
+        std::vector<ReactorTarget*> garbage;
+        //Event data of targets to serve again in next round (Read budget exhausted)
+        std::vector<uint64_t> ready;
+        //Event data of targets being served again in current round
+        std::vector<uint64_t> ready_current;
     };
 
     //Epoll data
     extern thread_local EpollData* epoll_data;
+
+    //Add reactor target to lookup table
+    //(Returns epoll event data identifying this registration)
+    uint64_t epoll_table_add(int fd, ReactorTarget* target);
+    //Serve target again in next round (Edge-triggered events will not repeat)
+    void epoll_requeue(uint64_t event_data);
 }
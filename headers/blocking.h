@@ -0,0 +1,112 @@
+#pragma once
+
+#include <stddef.h>
+#include <exception>
+#include <utility>
+#include <libasync/promise.h>
+#include <libasync/taskloop.h>
+#include <libasync/threadpool.h>
+
+namespace libasync
+{   //Blocking namespace
+    namespace blocking
+    {   //Default amount of blocking pool threads
+        static const size_t BLOCKING_POOL_SIZE = 4;
+
+        //Get blocking pool (Started on first use)
+        ThreadPoolLoop pool();
+
+        //Settle task type (Runs on calling loop)
+        template <typename T>
+        struct SettleTask
+        {   //Context of promise to settle
+            PromiseCtx<T> ctx;
+            //Result value
+            T value;
+            //Error (Rejects promise if set)
+            std::exception_ptr error;
+
+            //Settle promise
+            void operator()()
+            {   if (this->error)
+                    this->ctx.reject(this->error);
+                else
+                    this->ctx.resolve(std::move(this->value));
+            }
+        };
+
+        template <>
+        struct SettleTask<void>
+        {   //Context of promise to settle
+            PromiseCtx<void> ctx;
+            //Error (Rejects promise if set)
+            std::exception_ptr error;
+
+            //Settle promise
+            void operator()()
+            {   if (this->error)
+                    this->ctx.reject(this->error);
+                else
+                    this->ctx.resolve();
+            }
+        };
+
+        //Blocking task type (Runs on blocking pool)
+        template <typename T, typename F>
+        struct BlockingTask
+        {   //Blocking function
+            F func;
+            //Loop to settle promise on
+            TaskLoop loop;
+            //Context of promise to settle
+            PromiseCtx<T> ctx;
+
+            //Run function and post result back
+            void operator()()
+            {   try
+                {   T value = this->func();
+                    this->loop.post(SettleTask<T>{std::move(this->ctx), std::move(value), nullptr}, TaskLoop::Priority::URGENT);
+                }
+                catch (...)
+                {   this->loop.post(SettleTask<T>{std::move(this->ctx), T(), std::current_exception()}, TaskLoop::Priority::URGENT);
+                }
+            }
+        };
+
+        template <typename F>
+        struct BlockingTask<void, F>
+        {   //Blocking function
+            F func;
+            //Loop to settle promise on
+            TaskLoop loop;
+            //Context of promise to settle
+            PromiseCtx<void> ctx;
+
+            //Run function and post result back
+            void operator()()
+            {   std::exception_ptr error;
+                try
+                {   this->func();
+                }
+                catch (...)
+                {   error = std::current_exception();
+                }
+                this->loop.post(SettleTask<void>{std::move(this->ctx), error}, TaskLoop::Priority::URGENT);
+            }
+        };
+    }
+
+    //Set amount of blocking pool threads (Effective only before first use of the pool)
+    void blocking_init(size_t n_threads = blocking::BLOCKING_POOL_SIZE);
+
+    //Run blocking function on blocking pool
+    //(The returned promise settles on task loop of calling thread, which needs the promise module)
+    template <typename T, typename F>
+    Promise<T> run_blocking(F func)
+    {   TaskLoop loop = TaskLoop::thread_loop();
+
+        return Promise<T>([&](PromiseCtx<T> ctx)
+        {   blocking::pool().post(blocking::BlockingTask<T, F>{std::move(func), loop, ctx});
+        });
+    }
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <stddef.h>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+//Default inline buffer size of callables (Bytes; override when building library and users alike)
+#ifndef LIBASYNC_CALLABLE_INLINE_SIZE
+#define LIBASYNC_CALLABLE_INLINE_SIZE 48
+#endif
+
+namespace libasync
+{   //Default inline buffer size of callables
+    static const size_t CALLABLE_INLINE_SIZE = LIBASYNC_CALLABLE_INLINE_SIZE;
+
+    //Move-only callable wrapper (Definition only)
+    template <typename Sig, size_t InlineSize = CALLABLE_INLINE_SIZE>
+    class Callable;
+
+    //Move-only callable wrapper
+    //(Targets fitting the inline buffer are stored without allocation; larger ones are boxed on heap)
+    template <typename RT, typename... AT, size_t InlineSize>
+    class Callable<RT(AT...), InlineSize>
+    {   //Operation table type
+        struct Ops
+        {   //Call target
+            RT (*invoke)(void* storage, AT&&... args);
+            //Move target to uninitialized storage and destroy source (Null if storage can be copied bitwise)
+            void (*move)(void* from, void* to);
+            //Destroy target (Null if nothing to destroy)
+            void (*destroy)(void* storage);
+        };
+
+        //Storage type
+        typedef typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type Storage;
+
+        //Check if target type is stored inline
+        template <typename F>
+        struct IsInline : public std::integral_constant<bool,
+            (sizeof(F)<=InlineSize)&&(alignof(std::max_align_t)%alignof(F)==0)&&std::is_nothrow_move_constructible<F>::value
+        > {};
+
+        //Check if inline target can be moved bitwise and needs no destruction
+        template <typename F>
+        struct IsTrivial : public std::integral_constant<bool,
+            std::is_trivially_copyable<F>::value&&std::is_trivially_destructible<F>::value
+        > {};
+
+        //Operations of inline target
+        template <typename F>
+        struct InlineOps
+        {   static RT invoke(void* storage, AT&&... args)
+            {   return static_cast<RT>((*static_cast<F*>(storage))(std::forward<AT>(args)...));
+            }
+
+            static void move(void* from, void* to)
+            {   F* target = static_cast<F*>(from);
+                new (to) F(std::move(*target));
+                target->~F();
+            }
+
+            static void destroy(void* storage)
+            {   static_cast<F*>(storage)->~F();
+            }
+
+            static const Ops* table()
+            {   static const Ops ops = {&invoke, IsTrivial<F>::value?nullptr:&move, IsTrivial<F>::value?nullptr:&destroy};
+                return &ops;
+            }
+        };
+
+        //Operations of heap target
+        template <typename F>
+        struct HeapOps
+        {   static RT invoke(void* storage, AT&&... args)
+            {   return static_cast<RT>((**static_cast<F**>(storage))(std::forward<AT>(args)...));
+            }
+
+            static void destroy(void* storage)
+            {   delete *static_cast<F**>(storage);
+            }
+
+            static const Ops* table()
+            {   static const Ops ops = {&invoke, nullptr, &destroy};
+                return &ops;
+            }
+        };
+
+        //Target storage
+        mutable Storage storage;
+        //Operation table (Null if empty)
+        const Ops* ops;
+
+        //Store inline target
+        template <typename F>
+        void store(F&& func, std::true_type)
+        {   typedef typename std::decay<F>::type Target;
+
+            new (&this->storage) Target(std::forward<F>(func));
+            this->ops = InlineOps<Target>::table();
+        }
+
+        //Store heap target
+        template <typename F>
+        void store(F&& func, std::false_type)
+        {   typedef typename std::decay<F>::type Target;
+
+            *reinterpret_cast<Target**>(&this->storage) = new Target(std::forward<F>(func));
+            this->ops = HeapOps<Target>::table();
+        }
+
+        //Move target of other callable into empty storage of this one
+        void take(Callable& other) noexcept
+        {   if (!other.ops)
+                return;
+
+            if (other.ops->move)
+                other.ops->move(&other.storage, &this->storage);
+            else
+                this->storage = other.storage;
+            this->ops = other.ops;
+            other.ops = nullptr;
+        }
+    public:
+        //Construct an empty callable
+        Callable() noexcept : ops(nullptr) {}
+        Callable(std::nullptr_t) noexcept : ops(nullptr) {}
+
+        //Construct from a function object
+        //(Result must convert to return type; any result is accepted and discarded if return type is void)
+        template <typename F, typename = typename std::enable_if<
+            (!std::is_same<typename std::decay<F>::type, Callable>::value)&&
+            (std::is_void<RT>::value||
+            std::is_convertible<decltype(std::declval<typename std::decay<F>::type&>()(std::declval<AT>()...)), RT>::value)
+        >::type>
+        Callable(F&& func) : ops(nullptr)
+        {   typedef typename std::decay<F>::type Target;
+            this->store(std::forward<F>(func), IsInline<Target>());
+        }
+
+        //Move constructor
+        Callable(Callable&& other) noexcept : ops(nullptr)
+        {   this->take(other);
+        }
+
+        //Not copyable
+        Callable(const Callable&) = delete;
+        Callable& operator=(const Callable&) = delete;
+
+        //Destructor
+        ~Callable()
+        {   this->reset();
+        }
+
+        //Move assignment
+        Callable& operator=(Callable&& other) noexcept
+        {   if (this!=&other)
+            {   this->reset();
+                this->take(other);
+            }
+            return *this;
+        }
+
+        //Reset to empty
+        Callable& operator=(std::nullptr_t) noexcept
+        {   this->reset();
+            return *this;
+        }
+
+        //Destroy target
+        void reset() noexcept
+        {   if (this->ops&&this->ops->destroy)
+                this->ops->destroy(&this->storage);
+            this->ops = nullptr;
+        }
+
+        //Swap targets
+        void swap(Callable& other) noexcept
+        {   Callable temp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(temp);
+        }
+
+        //Check if a target is stored
+        explicit operator bool() const noexcept
+        {   return this->ops!=nullptr;
+        }
+
+        //Call target (Throws "std::bad_function_call" if empty)
+        RT operator()(AT... args) const
+        {   if (!this->ops)
+                throw std::bad_function_call();
+            return this->ops->invoke(&this->storage, std::forward<AT>(args)...);
+        }
+    };
+}
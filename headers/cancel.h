@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stddef.h>
+#include <exception>
+#include <map>
+#include <memory>
+#include <libasync/callable.h>
+
+namespace libasync
+{   //Cancellation exception (Rejection reason of cancelled operations)
+    class CancelledError : public std::exception
+    {public:
+        //Get error information
+        const char* what() const noexcept;
+    };
+
+    //Cancel token class
+    //(Copies share cancellation state; use on the thread running the cancellable operations)
+    class CancelToken
+    {public:
+        //Cancel callback type
+        typedef Callable<void()> Callback;
+    private:
+        //Cancel token data type
+        struct CancelTokenData
+        {   //Cancelled
+            bool cancelled;
+            //Callback handle counter
+            size_t counter;
+            //Callbacks (In registration order)
+            std::map<size_t, Callback> callbacks;
+
+            //Constructor
+            CancelTokenData() : cancelled(false), counter(1) {}
+        };
+
+        //Cancel token data reference type
+        typedef std::shared_ptr<CancelTokenData> CancelTokenDataRef;
+
+        //Cancel token data
+        CancelTokenDataRef data;
+    public:
+        //Constructor
+        CancelToken();
+
+        //Cancel (Calls callbacks once in registration order; later calls do nothing)
+        void cancel();
+        //Check if cancelled
+        bool cancelled();
+
+        //Add cancel callback (Called at once if already cancelled; returns 0 then)
+        size_t on_cancel(Callback callback);
+        //Remove cancel callback
+        bool off_cancel(size_t handle);
+    };
+}
@@ -1,12 +1,13 @@
 #pragma once
 
 #include <string>
-#include <functional>
+#include <map>
 #include <unordered_map>
-#include <list>
 #include <memory>
 #include <type_traits>
+#include <utility>
 #include <boost/any.hpp>
+#include <libasync/callable.h>
 #include <libasync/func_traits.h>
 #include <libasync/misc.h>
 
@@ -26,19 +27,32 @@ namespace libasync
         struct EventArgCastTrait<FT, 1>
         {   typedef typename FnTrait<FT>::template Arg<0>::Type Type;
         };
+
+        //Event handler wrapper (Casts event result to argument type of handler)
+        template <typename RT, typename HT>
+        struct EventHandlerWrapper
+        {   //Handler
+            HT handler;
+
+            //Call handler
+            void operator()(boost::any result)
+            {   CallWithOptArg<RT, HT>::call(this->handler, cast_any<RT>(result));
+            }
+        };
     }
 
     //Event mix-in class
     class EventMixin
     {public:
         //Event handler type
-        typedef std::function<void(boost::any)> EventHandler;
+        typedef Callable<void(boost::any)> EventHandler;
     private:
         //Event handler store type
-        typedef std::unordered_map<size_t, EventHandler> EventHandlerStore;
+        //(Ordered by handle, so handlers are called in registration order)
+        typedef std::map<size_t, EventHandler> EventHandlerStore;
         //Complete handler store type
         typedef std::unordered_map<std::string, EventHandlerStore> CompleteHandlerStore;
-
+    protected:
         //Event mix-in data type
         struct EventMixinData
         {   //Complete handler store
@@ -52,26 +66,58 @@ namespace libasync
 
         //Event mix-in data reference type
         typedef std::shared_ptr<EventMixinData> EventMixinDataRef;
-
+    private:
         //Event mix-in data
         EventMixinDataRef data;
     protected:
         //Internal constructor
         EventMixin();
+        //Internal constructor (Event data stored inside data of derived class)
+        EventMixin(EventMixinDataRef _data);
 
         //Trigger event
         template <typename T>
         void trigger(std::string event, T result)
-        {   auto store = this->data->store;
+        {   auto data = this->data;
             //Find event handler store
-            auto result_ptr = store.find(event);
+            auto result_ptr = data->store.find(event);
 
             //Not found; do nothing
-            if (result_ptr==store.end())
+            if (result_ptr==data->store.end())
                 return;
-            //Call back
-            for (auto item_pair : result_ptr->second)
-                item_pair.second(result);
+            //Call back handlers added before triggering
+            //(Handlers may add or remove handlers; each is moved out while it runs)
+            EventHandlerStore& handlers = result_ptr->second;
+            size_t end_handle = data->counter;
+            boost::any _result(result);
+
+            auto handler_ptr = handlers.begin();
+            while ((handler_ptr!=handlers.end())&&(handler_ptr->first<end_handle))
+            {   size_t handle = handler_ptr->first;
+                //Handler running in an outer trigger
+                if (!handler_ptr->second)
+                {   handler_ptr++;
+                    continue;
+                }
+
+                EventHandler handler(std::move(handler_ptr->second));
+                try
+                {   handler(_result);
+                }
+                catch (...)
+                {   this->restore_handler(handlers, handle, handler);
+                    throw;
+                }
+                this->restore_handler(handlers, handle, handler);
+                handler_ptr = handlers.upper_bound(handle);
+            }
+        }
+
+        //Put handler back after it runs (Unless it was removed meanwhile)
+        static void restore_handler(EventHandlerStore& handlers, size_t handle, EventHandler& handler)
+        {   auto handler_ptr = handlers.find(handle);
+            if (handler_ptr!=handlers.end())
+                handler_ptr->second = std::move(handler);
         }
 
         void trigger(std::string event);
@@ -91,15 +137,11 @@ namespace libasync
             typedef typename detail::EventArgCastTrait<HT, FnTrait<HT>::n_args>::Type ResultType;
 
             auto data = this->data;
-            //Event handler
-            EventHandler _handler = [=](boost::any _result)
-            {   detail::CallWithOptArg<ResultType, HT>::call(handler, detail::cast_any<ResultType>(_result));
-            };
             //Create a new handle
             size_t handle = data->counter;
             data->counter++;
             //Insert into handler store
-            data->store[event][handle] = _handler;
+            data->store[event][handle] = detail::EventHandlerWrapper<ResultType, HT>{std::move(handler)};
 
             return handle;
         }
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stddef.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <libasync/socket.h>
+#include <libasync/taskloop.h>
+
+namespace libasync
+{   //Loop group class
+    //(Runs a task loop with its own promise, reactor and timer modules on each thread)
+    class LoopGroup
+    {public:
+        //Thread task type (Called with thread index)
+        typedef std::function<void(size_t)> ThreadTask;
+        //Connection handler type (Called on thread accepting the connection)
+        typedef std::function<void(Socket)> ConnectHandler;
+    private:
+        //Listening sockets type (Owned by one thread; outlives group data if that thread releases the group)
+        typedef std::shared_ptr<std::vector<ServerSocket>> ListenersRef;
+
+        //Loop group data type
+        struct LoopGroupData
+        {   //Threads
+            std::vector<std::thread> threads;
+            //Task loop of each thread
+            std::vector<TaskLoop> loops;
+            //Listening sockets of each thread (Accessed by owning thread only)
+            std::vector<ListenersRef> listeners;
+
+            //Lock for fields below
+            std::mutex lock;
+            //Condition variable for fields below
+            std::condition_variable cond;
+            //Amount of threads finished initialization
+            size_t n_ready;
+            //Initialization error
+            std::exception_ptr error;
+
+            //Constructor
+            LoopGroupData() : n_ready(0) {}
+            //Destructor
+            ~LoopGroupData();
+        };
+
+        //Loop group data reference type
+        typedef std::shared_ptr<LoopGroupData> LoopGroupDataRef;
+
+        //Loop group data
+        LoopGroupDataRef data;
+
+        //Thread main function
+        //(Group data may be released on this thread while loop runs; not used after loop exits)
+        static void thread_main(LoopGroupData* data, size_t index, ListenersRef listeners, ThreadTask init);
+    public:
+        //Constructor
+        //(Zero threads means one thread per CPU; init is called on each thread before its loop runs)
+        LoopGroup(size_t n_threads = 0, ThreadTask init = nullptr);
+
+        //Get amount of threads
+        size_t size();
+        //Get task loop of given thread
+        TaskLoop loop(size_t index);
+        //Get task loops of all threads (Usable as server socket workers)
+        std::vector<TaskLoop> loops();
+
+        //Run task on each thread and wait until all finish (Rethrows first error)
+        //(Must not be called from threads of this group)
+        void each(ThreadTask task);
+        //Listen on each thread with SO_REUSEPORT sharding
+        //(Port must be non-zero; steering pins each thread to CPU with same index and maps its listener to that CPU)
+        void listen(in_addr_t addr, in_port_t port, ConnectHandler handler, int backlog = SOMAXCONN, bool steer_cpu = false);
+
+        //Stop all loops
+        void stop();
+        //Wait for all threads to exit
+        void join();
+    };
+}
@@ -59,7 +59,7 @@ namespace libasync
         template <typename T, typename F>
         struct CallWithOptArgHelper<T, F, 0>
         {   //Call function
-            static typename FnTrait<F>::ReturnType call(F func, T arg)
+            static typename FnTrait<F>::ReturnType call(F& func, T arg)
             {   return func();
             }
         };
@@ -67,7 +67,7 @@ namespace libasync
         template <typename T, typename F>
         struct CallWithOptArgHelper<T, F, 1>
         {   //Call function
-            static typename FnTrait<F>::ReturnType call(F func, T arg)
+            static typename FnTrait<F>::ReturnType call(F& func, T arg)
             {   return func(arg);
             }
         };
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <stddef.h>
+#include <iterator>
 #include <functional>
 #include <memory>
 #include <list>
 #include <type_traits>
 #include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 #include <boost/blank.hpp>
+#include <boost/intrusive_ptr.hpp>
+#include <libasync/callable.h>
+#include <libasync/cancel.h>
 #include <libasync/func_traits.h>
 #include <libasync/taskloop.h>
 #include <libasync/misc.h>
@@ -27,10 +35,89 @@ namespace libasync
 
     //Promise namespace
     namespace promise
-    {   //Promise data base type
+    {   //Allocate promise data from pool of current thread
+        void* pool_alloc(size_t size);
+        //Return promise data to pool of current thread
+        void pool_free(void* ptr, size_t size);
+
+        //Promise data base type
+        //(Reference count is not atomic; promise data belongs to the thread that created it)
         struct PromiseDataBase
-        {   //Call callbacks
+        {   //Reference count
+            size_t n_refs;
+
+            //Constructor
+            PromiseDataBase() : n_refs(0) {}
+            //Destructor
+            virtual ~PromiseDataBase() {}
+
+            //Call callbacks
             virtual void call_back() = 0;
+
+            //Allocate from promise data pool
+            static void* operator new(size_t size)
+            {   return pool_alloc(size);
+            }
+
+            //Return to promise data pool (Size of actual type is passed through virtual destructor)
+            static void operator delete(void* ptr, size_t size)
+            {   pool_free(ptr, size);
+            }
+        };
+
+        //Intrusive reference counting of promise data
+        inline void intrusive_ptr_add_ref(PromiseDataBase* data)
+        {   data->n_refs++;
+        }
+
+        inline void intrusive_ptr_release(PromiseDataBase* data)
+        {   if (--data->n_refs==0)
+                delete data;
+        }
+
+        //Copy value (Copyable type)
+        template <typename T>
+        inline T copy_value(T& value, std::true_type)
+        {   return value;
+        }
+
+        //Copy value (Move-only type)
+        template <typename T>
+        inline T copy_value(T& value, std::false_type)
+        {   throw std::logic_error("Move-only promise value cannot be shared by several continuations");
+        }
+
+        //Take value (Moved if allowed, otherwise copied)
+        template <typename T>
+        inline T take_value(T& value, bool movable)
+        {   if (movable)
+                return std::move(value);
+            return copy_value(value, std::is_copy_constructible<T>());
+        }
+
+        //Pass value to callback parameter of given type
+        template <typename T, typename P>
+        struct ValuePass
+        {   //By value or rvalue reference; moved if allowed
+            static T pass(T& value, bool movable)
+            {   return take_value(value, movable);
+            }
+        };
+
+        template <typename T>
+        struct ValuePass<T, T&>
+        {   //By reference; shared
+            static T& pass(T& value, bool movable)
+            {   return value;
+            }
+        };
+
+        template <typename T>
+        struct ValuePass<T, const T&>
+        {   //By const reference; shared
+            static const T& pass(T& value, bool movable)
+            {   return value;
+            }
         };
 
         //Fulfilled callback helper (Definition only)
@@ -48,7 +135,7 @@ namespace libasync
         struct RejectedHelper<void, void, ET, RF>;
 
         //Promise data base reference type
-        typedef std::shared_ptr<PromiseDataBase> PromiseDataBaseRef;
+        typedef boost::intrusive_ptr<PromiseDataBase> PromiseDataBaseRef;
 
         //Extract wrapped type
         template <typename T>
@@ -66,7 +153,14 @@ namespace libasync
         using Lift = Promise<typename Extract<T>::Type>;
 
         //Pending callback queue
-        extern thread_local std::list<PromiseDataBaseRef>* pending_callback_queue;
+        extern thread_local std::vector<PromiseDataBaseRef>* pending_callback_queue;
+        //Inline callback limit of current thread (0 disables inline calling back)
+        extern thread_local size_t inline_limit;
+        //Inline callback queue (Promises called back within current outermost settling call)
+        extern thread_local std::vector<PromiseDataBaseRef>* inline_queue;
+
+        //Call back promise within the settling call (Trampolined; nested settling is queued, not recursed)
+        void call_back_inline(PromiseDataBaseRef data);
 
         //Promise task
         void promise_task();
@@ -74,6 +168,8 @@ namespace libasync
 
     //Initialize promise module for current thread
     void promise_init();
+    //Set inline callback limit of current thread (0 disables inline calling back)
+    void promise_set_inline_limit(size_t max_callbacks);
 
     //Promise context class
     template <typename T>
@@ -90,11 +186,11 @@ namespace libasync
     public:
         //Resolve promise
         void resolve(T value)
-        {   Promise<T>::resolve_impl(this->data, value);
+        {   Promise<T>::resolve_impl(this->data, std::move(value));
         }
 
         void resolve(Promise<T> promise)
-        {   Promise<T>::resolve_impl(this->data, promise);
+        {   Promise<T>::resolve_impl(this->data, std::move(promise));
         }
 
         //Reject promise
@@ -111,6 +207,112 @@ namespace libasync
         REJECTED
     };
 
+    //Settled promise result (Used by "all_settled()")
+    template <typename T>
+    struct PromiseResult
+    {   //Promise status
+        PromiseStatus status;
+        //Resolved value
+        T value;
+        //Rejected error
+        std::exception_ptr error;
+    };
+
+    template <>
+    struct PromiseResult<void>
+    {   //Promise status
+        PromiseStatus status;
+        //Rejected error
+        std::exception_ptr error;
+    };
+
+    //Error of "any()" when all promises are rejected
+    class AggregateError : public std::runtime_error
+    {public:
+        //Errors of all promises (In input order)
+        std::vector<std::exception_ptr> errors;
+
+        //Constructor
+        AggregateError(std::vector<std::exception_ptr> _errors) : std::runtime_error("All promises were rejected"),
+            errors(std::move(_errors)) {}
+    };
+
+    namespace promise
+    {   //Combinator state base type
+        //(One per combinator call, shared by callbacks of all input promises)
+        struct CombinatorState
+        {   //Reference count
+            size_t n_refs;
+            //Amount of input promises not settled yet
+            size_t n_pending;
+
+            //Constructor
+            CombinatorState(size_t _n_pending) : n_refs(0), n_pending(_n_pending) {}
+            //Destructor
+            virtual ~CombinatorState() {}
+
+            //Allocate from promise data pool
+            static void* operator new(size_t size)
+            {   return pool_alloc(size);
+            }
+
+            //Return to promise data pool
+            static void operator delete(void* ptr, size_t size)
+            {   pool_free(ptr, size);
+            }
+        };
+
+        //Intrusive reference counting of combinator state
+        inline void intrusive_ptr_add_ref(CombinatorState* state)
+        {   state->n_refs++;
+        }
+
+        inline void intrusive_ptr_release(CombinatorState* state)
+        {   if (--state->n_refs==0)
+                delete state;
+        }
+
+        //Combinator result helper
+        template <typename T>
+        struct CombinatorResult
+        {   //Result type of "all()"
+            typedef std::vector<T> AllType;
+            //Result element type of "all_settled()"
+            typedef PromiseResult<T> SettledType;
+
+            //Prepare result of "all()"
+            static void init(AllType& values, size_t n)
+            {   values.resize(n);
+            }
+
+            //Store value (Throws if a move-only value cannot be taken)
+            static void store(AllType& values, size_t index, T& value, bool movable)
+            {   values[index] = take_value(value, movable);
+            }
+
+            static void store(SettledType& result, T& value, bool movable)
+            {   result.value = take_value(value, movable);
+            }
+        };
+
+        //Combinator result helper (For void promises; no values are kept)
+        template <>
+        struct CombinatorResult<boost::blank>
+        {   //Result type of "all()"
+            typedef boost::blank AllType;
+            //Result element type of "all_settled()"
+            typedef PromiseResult<void> SettledType;
+
+            //Prepare result of "all()"
+            static void init(AllType& values, size_t n) {}
+
+            //Store value
+            static void store(AllType& values, size_t index, boost::blank& value, bool movable) {}
+
+            static void store(SettledType& result, boost::blank& value, bool movable) {}
+        };
+    }
+
     //Promise class
     template <typename T>
     class Promise
@@ -118,12 +320,60 @@ namespace libasync
         //Promise data type (Definition)
         struct PromiseData;
         //Promise data reference type
-        typedef std::shared_ptr<PromiseData> PromiseDataRef;
+        typedef boost::intrusive_ptr<PromiseData> PromiseDataRef;
 
-        //Resolve wrapper type
-        typedef std::function<void(T)> ResolveWrapper;
+        //Resolve wrapper type (Value may be moved from if second argument is true)
+        typedef Callable<void(T&, bool)> ResolveWrapper;
         //Reject wrapper type
-        typedef std::function<void(std::exception_ptr)> RejectWrapper;
+        typedef Callable<void(std::exception_ptr)> RejectWrapper;
+
+        //Fulfilled callback wrapper type
+        template <typename U, typename FF>
+        struct FulfilledWrapper
+        {   //Fulfilled callback
+            FF fulfilled;
+            //Data of promise returned by "then()"
+            typename Promise<U>::PromiseDataRef outer_data;
+
+            //Call fulfilled callback and settle returned promise
+            void operator()(T& value, bool movable)
+            {   typedef typename FnTrait<FF>::ReturnType ReturnType;
+                Promise<U> inner_promise = promise::FulfilledHelper<U, ReturnType, T, FF>::run(value, movable, this->fulfilled);
+                Promise<U>::associate_status(this->outer_data, std::move(inner_promise.data));
+            }
+        };
+
+        //Rejected callback wrapper type
+        template <typename U, typename RF>
+        struct RejectedWrapper
+        {   //Rejected callback
+            RF rejected;
+            //Data of promise returned by "_catch()"
+            typename Promise<U>::PromiseDataRef outer_data;
+
+            //Call rejected callback and settle returned promise
+            void operator()(std::exception_ptr error)
+            {   typedef typename FnTrait<RF>::ReturnType ReturnType;
+                typedef typename FnTrait<RF>::template Arg<0>::Type ErrorType;
+                Promise<U> inner_promise = promise::RejectedHelper<U, ReturnType, ErrorType, RF>::run(
+                    detail::eptr_cast<ErrorType>(error),
+                    this->rejected
+                );
+                Promise<U>::associate_status(this->outer_data, std::move(inner_promise.data));
+            }
+        };
+
+        //Rejection forwarding callback type (Used by "then()" without rejected callback)
+        template <typename U>
+        struct ForwardRejected
+        {   //Data of promise returned by "then()"
+            typename Promise<U>::PromiseDataRef outer_data;
+
+            //Reject returned promise with same error
+            void operator()(std::exception_ptr error)
+            {   Promise<U>::reject_impl(this->outer_data, error);
+            }
+        };
 
         //Promise data type
         struct PromiseData : public promise::PromiseDataBase
@@ -134,28 +384,64 @@ namespace libasync
 
             //Resolved value
             T value;
-            //Fulfilled wrappers
+            //First fulfilled wrapper (Stored inline; most promises have a single continuation)
+            ResolveWrapper fulfilled_wrapper;
+            //Other fulfilled wrappers
             std::list<ResolveWrapper> fulfilled_wrappers;
 
             //Rejected error
             std::exception_ptr error;
-            //Rejected wrappers
+            //First rejected wrapper
+            RejectWrapper rejected_wrapper;
+            //Other rejected wrappers
             std::list<RejectWrapper> rejected_wrappers;
 
+            //Constructor
+            PromiseData() : status(PromiseStatus::PENDING), pending_callback(false), value() {}
+
+            //Add fulfilled wrapper
+            void add_fulfilled(ResolveWrapper&& wrapper)
+            {   if (!this->fulfilled_wrapper)
+                    this->fulfilled_wrapper = std::move(wrapper);
+                else
+                    this->fulfilled_wrappers.push_back(std::move(wrapper));
+            }
+
+            //Add rejected wrapper
+            void add_rejected(RejectWrapper&& wrapper)
+            {   if (!this->rejected_wrapper)
+                    this->rejected_wrapper = std::move(wrapper);
+                else
+                    this->rejected_wrappers.push_back(std::move(wrapper));
+            }
+
             //Call back
+            //(Wrappers added meanwhile are appended to lists and called in the same pass)
             void call_back()
             {   //Resolved
                 if (this->status==PromiseStatus::RESOLVED)
-                    for (auto wrapper : this->fulfilled_wrappers)
-                        wrapper(this->value);
+                {   //Value is moved to last continuation if nothing else refers to this promise
+                    //(Caller holds the only other reference)
+                    //(Checked as each wrapper is called; wrappers added while one runs are called after it)
+                    auto& wrappers = this->fulfilled_wrappers;
+                    if (this->fulfilled_wrapper)
+                        this->fulfilled_wrapper(this->value, wrappers.empty()&&(this->n_refs==1));
+                    for (auto it=wrappers.begin();it!=wrappers.end();++it)
+                        (*it)(this->value, (std::next(it)==wrappers.end())&&(this->n_refs==1));
+                }
                 //Rejected
                 else if (this->status==PromiseStatus::REJECTED)
-                    for (auto wrapper : this->rejected_wrappers)
+                {   if (this->rejected_wrapper)
+                        this->rejected_wrapper(this->error);
+                    for (auto& wrapper : this->rejected_wrappers)
                         wrapper(this->error);
+                }
 
                 this->pending_callback = false;
-                //Clear wrappers queue
+                //Clear wrappers
+                this->fulfilled_wrapper = nullptr;
                 this->fulfilled_wrappers.clear();
+                this->rejected_wrapper = nullptr;
                 this->rejected_wrappers.clear();
             }
         };
@@ -163,6 +449,17 @@ namespace libasync
         //Promise data
         PromiseDataRef data;
 
+        //Call back settled promise within the settling call if inline limit allows, otherwise queue it for promise task
+        //(Move-only values are always queued; the settling caller may still refer to the promise and force a copy)
+        static void schedule(const PromiseDataRef& data)
+        {   data->pending_callback = true;
+            if (std::is_copy_constructible<T>::value&&(promise::inline_limit>0)&&
+                (promise::inline_queue->size()<promise::inline_limit))
+                promise::call_back_inline(data);
+            else
+                promise::pending_callback_queue->push_back(data);
+        }
+
         //Resolve promise (Implementation)
         static void resolve_impl(PromiseDataRef data, T value)
         {   //Already settled
@@ -171,11 +468,9 @@ namespace libasync
 
             //Set status and value
             data->status = PromiseStatus::RESOLVED;
-            data->value = value;
-            //Add to pending callback queue
-            data->pending_callback = true;
-            auto _data = std::static_pointer_cast<promise::PromiseDataBase>(data);
-            promise::pending_callback_queue->push_back(_data);
+            data->value = std::move(value);
+            //Call back or add to pending callback queue
+            Promise<T>::schedule(data);
         }
 
         static void resolve_impl(PromiseDataRef data, Promise<T> promise)
@@ -184,7 +479,18 @@ namespace libasync
                 return;
 
             //Associate promises
-            Promise<T>::associate_status(data, promise.data);
+            Promise<T>::associate_status(data, std::move(promise.data));
+        }
+
+        //Resolve promise with value of another promise
+        //(Rejects promise if value is move-only and cannot be taken)
+        static void resolve_from(PromiseDataRef data, T& value, bool movable)
+        {   try
+            {   Promise<T>::resolve_impl(data, promise::take_value(value, movable));
+            }
+            catch (...)
+            {   Promise<T>::reject_impl(data, std::current_exception());
+            }
         }
 
         //Reject promise (Implementation)
@@ -197,18 +503,17 @@ namespace libasync
             //Set status and error
             data->status = PromiseStatus::REJECTED;
             data->error = detail::eptr_make(error);
-            //Add to pending callback queue
-            data->pending_callback = true;
-            auto _data = std::static_pointer_cast<promise::PromiseDataBase>(data);
-            promise::pending_callback_queue->push_back(_data);
+            //Call back or add to pending callback queue
+            Promise<T>::schedule(data);
         }
 
         //Associate promise status
+        //(Value of inner promise is moved if nothing else refers to it)
         static void associate_status(PromiseDataRef outer_data, PromiseDataRef inner_data)
         {   switch (inner_data->status)
             {   //Resolved
                 case PromiseStatus::RESOLVED:
-                {   Promise<T>::resolve_impl(outer_data, inner_data->value);
+                {   Promise<T>::resolve_from(outer_data, inner_data->value, inner_data->n_refs==1);
                     break;
                 }
                 //Rejected
@@ -219,11 +524,11 @@ namespace libasync
                 //Pending
                 case PromiseStatus::PENDING:
                 {   //Internal fulfilled callback
-                    inner_data->fulfilled_wrappers.push_back([=](T value)
-                    {   Promise<T>::resolve_impl(outer_data, value);
+                    inner_data->add_fulfilled([=](T& value, bool movable)
+                    {   Promise<T>::resolve_from(outer_data, value, movable);
                     });
                     //Internal rejected callback
-                    inner_data->rejected_wrappers.push_back([=](std::exception_ptr error)
+                    inner_data->add_rejected([=](std::exception_ptr error)
                     {   Promise<T>::reject_impl(outer_data, error);
                     });
                     break;
@@ -231,25 +536,305 @@ namespace libasync
             }
         }
 
+        //Add callbacks to promise and queue them if it is already settled
+        static void add_callbacks(PromiseDataRef data, ResolveWrapper&& fulfilled, RejectWrapper&& rejected)
+        {   data->add_fulfilled(std::move(fulfilled));
+            data->add_rejected(std::move(rejected));
+
+            if ((data->status!=PromiseStatus::PENDING)&&(!data->pending_callback))
+                Promise<T>::schedule(data);
+        }
+
+        //Combinator result helper type
+        typedef promise::CombinatorResult<T> Result;
+        //Result type of "all()"
+        typedef typename Result::AllType AllType;
+        //Result element type of "all_settled()"
+        typedef typename Result::SettledType SettledType;
+
+        //"all()" state type
+        struct AllState : public promise::CombinatorState
+        {   //Values in input order
+            AllType values;
+            //Data of returned promise
+            typename Promise<AllType>::PromiseDataRef outer_data;
+
+            //Constructor
+            AllState(size_t n, typename Promise<AllType>::PromiseDataRef _outer_data) : CombinatorState(n), outer_data(_outer_data)
+            {   Result::init(this->values, n);
+            }
+        };
+
+        //"all()" fulfilled callback type
+        struct AllFulfilled
+        {   //Shared state
+            boost::intrusive_ptr<AllState> state;
+            //Index of input promise
+            size_t index;
+
+            //Store value; resolve when all are stored
+            void operator()(T& value, bool movable)
+            {   auto state = this->state.get();
+                //Already rejected
+                if (state->outer_data->status!=PromiseStatus::PENDING)
+                    return;
+
+                try
+                {   Result::store(state->values, this->index, value, movable);
+                }
+                catch (...)
+                {   Promise<AllType>::reject_impl(state->outer_data, std::current_exception());
+                    return;
+                }
+                if (--state->n_pending==0)
+                    Promise<AllType>::resolve_impl(state->outer_data, std::move(state->values));
+            }
+        };
+
+        //"all()" rejected callback type
+        struct AllRejected
+        {   //Shared state
+            boost::intrusive_ptr<AllState> state;
+
+            //Reject with first error
+            void operator()(std::exception_ptr error)
+            {   Promise<AllType>::reject_impl(this->state->outer_data, error);
+            }
+        };
+
+        //"any()" state type
+        struct AnyState : public promise::CombinatorState
+        {   //Errors in input order
+            std::vector<std::exception_ptr> errors;
+            //Data of returned promise
+            PromiseDataRef outer_data;
+
+            //Constructor
+            AnyState(size_t n, PromiseDataRef _outer_data) : CombinatorState(n), errors(n), outer_data(_outer_data) {}
+        };
+
+        //"any()" fulfilled callback type
+        struct AnyFulfilled
+        {   //Shared state
+            boost::intrusive_ptr<AnyState> state;
+
+            //Resolve with first value
+            void operator()(T& value, bool movable)
+            {   auto& outer_data = this->state->outer_data;
+                if (outer_data->status==PromiseStatus::PENDING)
+                    Promise<T>::resolve_from(outer_data, value, movable);
+            }
+        };
+
+        //"any()" rejected callback type
+        struct AnyRejected
+        {   //Shared state
+            boost::intrusive_ptr<AnyState> state;
+            //Index of input promise
+            size_t index;
+
+            //Store error; reject when all are rejected
+            void operator()(std::exception_ptr error)
+            {   auto state = this->state.get();
+
+                state->errors[this->index] = error;
+                if (--state->n_pending==0)
+                    Promise<T>::reject_impl(state->outer_data, AggregateError(std::move(state->errors)));
+            }
+        };
+
+        //"race()" fulfilled callback type (No shared state besides returned promise)
+        struct RaceFulfilled
+        {   //Data of returned promise
+            PromiseDataRef outer_data;
+
+            //Resolve with first value
+            void operator()(T& value, bool movable)
+            {   if (this->outer_data->status==PromiseStatus::PENDING)
+                    Promise<T>::resolve_from(this->outer_data, value, movable);
+            }
+        };
+
+        //"race()" rejected callback type
+        struct RaceRejected
+        {   //Data of returned promise
+            PromiseDataRef outer_data;
+
+            //Reject with first error
+            void operator()(std::exception_ptr error)
+            {   Promise<T>::reject_impl(this->outer_data, error);
+            }
+        };
+
+        //"cancel_on()" fulfilled callback type
+        struct CancelFulfilled
+        {   //Data of returned promise
+            PromiseDataRef outer_data;
+            //Cancel token
+            CancelToken token;
+            //Cancel callback handle
+            size_t handle;
+
+            //Stop watching token; resolve with value
+            void operator()(T& value, bool movable)
+            {   this->token.off_cancel(this->handle);
+                if (this->outer_data->status==PromiseStatus::PENDING)
+                    Promise<T>::resolve_from(this->outer_data, value, movable);
+            }
+        };
+
+        //"cancel_on()" rejected callback type
+        struct CancelRejected
+        {   //Data of returned promise
+            PromiseDataRef outer_data;
+            //Cancel token
+            CancelToken token;
+            //Cancel callback handle
+            size_t handle;
+
+            //Stop watching token; reject with error
+            void operator()(std::exception_ptr error)
+            {   this->token.off_cancel(this->handle);
+                Promise<T>::reject_impl(this->outer_data, error);
+            }
+        };
+
+        //"all_settled()" state type
+        struct SettledState : public promise::CombinatorState
+        {   //Results in input order
+            std::vector<SettledType> results;
+            //Data of returned promise
+            typename Promise<std::vector<SettledType>>::PromiseDataRef outer_data;
+
+            //Constructor
+            SettledState(size_t n, typename Promise<std::vector<SettledType>>::PromiseDataRef _outer_data) : CombinatorState(n),
+                results(n), outer_data(_outer_data) {}
+
+            //Count settled promise; resolve when all are settled
+            void settle_one()
+            {   if (--this->n_pending==0)
+                    Promise<std::vector<SettledType>>::resolve_impl(this->outer_data, std::move(this->results));
+            }
+        };
+
+        //"all_settled()" fulfilled callback type
+        struct SettledFulfilled
+        {   //Shared state
+            boost::intrusive_ptr<SettledState> state;
+            //Index of input promise
+            size_t index;
+
+            //Store value
+            void operator()(T& value, bool movable)
+            {   auto& result = this->state->results[this->index];
+
+                result.status = PromiseStatus::RESOLVED;
+                try
+                {   Result::store(result, value, movable);
+                }
+                catch (...)
+                {   result.status = PromiseStatus::REJECTED;
+                    result.error = std::current_exception();
+                }
+                this->state->settle_one();
+            }
+        };
+
+        //"all_settled()" rejected callback type
+        struct SettledRejected
+        {   //Shared state
+            boost::intrusive_ptr<SettledState> state;
+            //Index of input promise
+            size_t index;
+
+            //Store error
+            void operator()(std::exception_ptr error)
+            {   auto& result = this->state->results[this->index];
+
+                result.status = PromiseStatus::REJECTED;
+                result.error = error;
+                this->state->settle_one();
+            }
+        };
+
+        //Wait for all promises (Implementation)
+        template <typename It>
+        static Promise<AllType> all_impl(It first, It last)
+        {   size_t n = std::distance(first, last);
+            if (n==0)
+                return Promise<AllType>::resolved(AllType());
+
+            Promise<AllType> outer_promise;
+            boost::intrusive_ptr<AllState> state(new AllState(n, outer_promise.data));
+            for (size_t i=0;first!=last;++first, i++)
+            {   const Promise<T>& promise = *first;
+                Promise<T>::add_callbacks(promise.data, AllFulfilled{state, i}, AllRejected{state});
+            }
+            return outer_promise;
+        }
+
+        //Wait for first fulfilled promise (Implementation)
+        template <typename It>
+        static Promise<T> any_impl(It first, It last)
+        {   size_t n = std::distance(first, last);
+            if (n==0)
+                return Promise<T>::rejected(AggregateError(std::vector<std::exception_ptr>()));
+
+            Promise<T> outer_promise;
+            boost::intrusive_ptr<AnyState> state(new AnyState(n, outer_promise.data));
+            for (size_t i=0;first!=last;++first, i++)
+            {   const Promise<T>& promise = *first;
+                Promise<T>::add_callbacks(promise.data, AnyFulfilled{state}, AnyRejected{state, i});
+            }
+            return outer_promise;
+        }
+
+        //Wait for first settled promise (Implementation)
+        template <typename It>
+        static Promise<T> race_impl(It first, It last)
+        {   Promise<T> outer_promise;
+            for (;first!=last;++first)
+            {   const Promise<T>& promise = *first;
+                Promise<T>::add_callbacks(promise.data, RaceFulfilled{outer_promise.data}, RaceRejected{outer_promise.data});
+            }
+            return outer_promise;
+        }
+
+        //Wait for all promises to settle (Implementation)
+        template <typename It>
+        static Promise<std::vector<SettledType>> all_settled_impl(It first, It last)
+        {   size_t n = std::distance(first, last);
+            if (n==0)
+                return Promise<std::vector<SettledType>>::resolved(std::vector<SettledType>());
+
+            Promise<std::vector<SettledType>> outer_promise;
+            boost::intrusive_ptr<SettledState> state(new SettledState(n, outer_promise.data));
+            for (size_t i=0;first!=last;++first, i++)
+            {   const Promise<T>& promise = *first;
+                Promise<T>::add_callbacks(promise.data, SettledFulfilled{state, i}, SettledRejected{state, i});
+            }
+            return outer_promise;
+        }
+
+        //Check if type is an iterator rather than a promise (Selects range overloads of combinators)
+        template <typename It>
+        using EnableRange = typename std::enable_if<!std::is_convertible<It, Promise<T>>::value>::type;
+
         //Friend classes
         friend class PromiseCtx<T>;
         template <typename U>
         friend class Promise;
     protected:
         //Internal constructor
-        Promise()
-        {   auto data = this->data = std::make_shared<PromiseData>();
-            data->status = PromiseStatus::PENDING;
-            data->pending_callback = false;
-        }
+        Promise() : data(new PromiseData()) {}
 
         //Resolve promise
         void resolve(T value)
-        {   Promise<T>::resolve_impl(this->data, value);
+        {   Promise<T>::resolve_impl(this->data, std::move(value));
         }
 
         void resolve(Promise<T> promise)
-        {   Promise<T>::resolve_impl(this->data, promise);
+        {   Promise<T>::resolve_impl(this->data, std::move(promise));
         }
 
         //Reject promise
@@ -272,7 +857,7 @@ namespace libasync
             auto data = promise.data;
 
             data->status = PromiseStatus::RESOLVED;
-            data->value = value;
+            data->value = std::move(value);
 
             return promise;
         }
@@ -293,6 +878,75 @@ namespace libasync
             return promise;
         }
 
+        //Wait for all promises of range (Resolves with values in input order; rejects with first error)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<std::vector<T>> all(It first, It last)
+        {   return Promise<T>::all_impl(first, last);
+        }
+
+        template <typename... PT>
+        static Promise<std::vector<T>> all(Promise<T> first, PT... rest)
+        {   Promise<T> promises[] = {first, rest...};
+            return Promise<T>::all_impl(promises, promises+1+sizeof...(rest));
+        }
+
+        //Wait for first fulfilled promise of range (Rejects with "AggregateError" if all are rejected)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<T> any(It first, It last)
+        {   return Promise<T>::any_impl(first, last);
+        }
+
+        template <typename... PT>
+        static Promise<T> any(Promise<T> first, PT... rest)
+        {   Promise<T> promises[] = {first, rest...};
+            return Promise<T>::any_impl(promises, promises+1+sizeof...(rest));
+        }
+
+        //Wait for first settled promise of range (Never settles if range is empty)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<T> race(It first, It last)
+        {   return Promise<T>::race_impl(first, last);
+        }
+
+        template <typename... PT>
+        static Promise<T> race(Promise<T> first, PT... rest)
+        {   Promise<T> promises[] = {first, rest...};
+            return Promise<T>::race_impl(promises, promises+1+sizeof...(rest));
+        }
+
+        //Wait for all promises of range to settle (Resolves with results in input order)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<std::vector<PromiseResult<T>>> all_settled(It first, It last)
+        {   return Promise<T>::all_settled_impl(first, last);
+        }
+
+        template <typename... PT>
+        static Promise<std::vector<PromiseResult<T>>> all_settled(Promise<T> first, PT... rest)
+        {   Promise<T> promises[] = {first, rest...};
+            return Promise<T>::all_settled_impl(promises, promises+1+sizeof...(rest));
+        }
+
+        //Settle with this promise, or reject with "CancelledError" if token is cancelled first
+        //(Cancellation propagates down "then()" chains of returned promise until caught)
+        //(Token keeps a cancel callback and returned promise until this promise settles or token is cancelled; do not
+        // bind promises that may never settle to a long-lived token)
+        Promise<T> cancel_on(CancelToken token)
+        {   if (token.cancelled())
+                return Promise<T>::rejected(CancelledError());
+
+            Promise<T> outer_promise;
+            auto outer_data = outer_promise.data;
+            size_t handle = token.on_cancel([=]()
+            {   Promise<T>::reject_impl(outer_data, CancelledError());
+            });
+            Promise<T>::add_callbacks(
+                this->data,
+                CancelFulfilled{outer_data, token, handle},
+                CancelRejected{outer_data, token, handle}
+            );
+            return outer_promise;
+        }
+
         //Then
         template <typename U, typename FF>
         Promise<U> then(FF fulfilled)
@@ -307,52 +961,64 @@ namespace libasync
                 "Fulfilled callback must have exactly one argument."
             );
             static_assert(
-                std::is_same<T, typename FnTrait<FF>::template Arg<0>::Type>::value,
+                std::is_same<T, typename std::decay<typename FnTrait<FF>::template Arg<0>::Type>::type>::value,
                 "The type of the first argument of the fulfilled callback must correspond with promise type."
             );
 
-            auto self_data = this->data;
             Promise<U> outer_promise;
             auto outer_data = outer_promise.data;
 
-            //Rejected
-            if (self_data->status==PromiseStatus::REJECTED)
-                return Promise<U>();
-            //Resolved
-            else if ((self_data->status==PromiseStatus::RESOLVED)&&(!self_data->pending_callback))
-            {   self_data->pending_callback = true;
-                //Add promise to pending callback queue
-                auto _self_data = std::static_pointer_cast<promise::PromiseDataBase>(self_data);
-                promise::pending_callback_queue->push_back(_self_data);
-            }
-
-            //Wrap fulfilled callback and push to queue
-            self_data->fulfilled_wrappers.push_back([=](T value)
-            {   //Can fulfilled callback
-                Promise<U> inner_promise = promise::FulfilledHelper<U, ReturnType, T, FF>::run(
-                    value,
-                    fulfilled
-                );
-                auto inner_data = inner_promise.data;
-
-                //Associate promise status
-                Promise<U>::associate_status(outer_data, inner_data);
-            });
+            //Wrap fulfilled callback; errors (Including cancellation) are forwarded to returned promise
+            Promise<T>::add_callbacks(
+                this->data,
+                FulfilledWrapper<U, FF>{std::move(fulfilled), outer_data},
+                ForwardRejected<U>{outer_data}
+            );
 
             return outer_promise;
         }
 
         template <typename U, typename FF, typename RF>
         Promise<U> then(FF fulfilled, RF rejected)
-        {   this->then<U>(fulfilled);
-            this->_catch<U>(rejected);
+        {   //Check function signatures
+            static_assert(
+                std::is_same<U, typename promise::Extract<typename FnTrait<FF>::ReturnType>::Type>::value,
+                "The return type of the fulfilled callback must correspond with returned promise type."
+            );
+            static_assert(
+                std::is_same<U, typename promise::Extract<typename FnTrait<RF>::ReturnType>::Type>::value,
+                "The return type of the rejected callback must correspond with returned promise type."
+            );
+            static_assert(
+                FnTrait<FF>::n_args==1,
+                "Fulfilled callback must have exactly one argument."
+            );
+            static_assert(
+                std::is_same<T, typename std::decay<typename FnTrait<FF>::template Arg<0>::Type>::type>::value,
+                "The type of the first argument of the fulfilled callback must correspond with promise type."
+            );
+            static_assert(
+                FnTrait<RF>::n_args==1,
+                "Rejected callback must have exactly one argument."
+            );
+
+            Promise<U> outer_promise;
+            auto outer_data = outer_promise.data;
+
+            //Wrap both callbacks (Only the one matching settled status is called)
+            Promise<T>::add_callbacks(
+                this->data,
+                FulfilledWrapper<U, FF>{std::move(fulfilled), outer_data},
+                RejectedWrapper<U, RF>{std::move(rejected), outer_data}
+            );
+
+            return outer_promise;
         }
 
         //Catch
         template <typename U, typename RF>
         Promise<U> _catch(RF rejected)
         {   typedef typename FnTrait<RF>::ReturnType ReturnType;
-            typedef typename FnTrait<RF>::template Arg<0>::Type ErrorType;
             //Check function signature
             static_assert(
                 std::is_same<U, typename promise::Extract<ReturnType>::Type>::value,
@@ -370,26 +1036,12 @@ namespace libasync
             //Resolved
             if (self_data->status==PromiseStatus::RESOLVED)
                 return Promise<U>();
-            //Rejected
-            else if ((self_data->status==PromiseStatus::REJECTED)&&(!self_data->pending_callback))
-            {   self_data->pending_callback = true;
-                //Add promise to pending callback queue
-                auto _self_data = std::static_pointer_cast<promise::PromiseDataBase>(self_data);
-                promise::pending_callback_queue->push_back(_self_data);
-            }
 
             //Wrap rejected callback and push to queue
-            self_data->rejected_wrappers.push_back([=](std::exception_ptr error)
-            {   //Can fulfilled callback
-                Promise<U> inner_promise = promise::RejectedHelper<U, ReturnType, ErrorType, RF>::run(
-                    detail::eptr_cast<ErrorType>(error),
-                    rejected
-                );
-                auto inner_data = inner_promise.data;
-
-                //Associate promise status
-                Promise<U>::associate_status(outer_data, inner_data);
-            });
+            self_data->add_rejected(RejectedWrapper<U, RF>{std::move(rejected), outer_data});
+            //Rejected; call back or add promise to pending callback queue
+            if ((self_data->status==PromiseStatus::REJECTED)&&(!self_data->pending_callback))
+                Promise<T>::schedule(self_data);
 
             return outer_promise;
         }
@@ -435,6 +1087,25 @@ namespace libasync
     template <>
     class Promise<void> : protected Promise<boost::blank>
     {private:
+        //Fulfilled callback wrapper type (Ignores placeholder value)
+        template <typename FF>
+        struct VoidFulfilledWrapper
+        {   //Fulfilled callback
+            FF fulfilled;
+
+            //Call fulfilled callback
+            typename FnTrait<FF>::ReturnType operator()(boost::blank _)
+            {   return this->fulfilled();
+            }
+        };
+
+        //Wrap placeholder promise
+        Promise(Promise<boost::blank> promise) : Promise<boost::blank>(promise) {}
+
+        //Check if type is an iterator rather than a promise (Selects range overloads of combinators)
+        template <typename It>
+        using EnableRange = typename std::enable_if<!std::is_convertible<It, Promise<void>>::value>::type;
+
         //Friend classes
         friend class PromiseCtx<void>;
         template <typename T>
@@ -490,6 +1161,59 @@ namespace libasync
             return promise;
         }
 
+        //Wait for all promises of range (Rejects with first error)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<void> all(It first, It last)
+        {   return Promise<void>(Promise<boost::blank>::all_impl(first, last));
+        }
+
+        template <typename... PT>
+        static Promise<void> all(Promise<void> first, PT... rest)
+        {   Promise<void> promises[] = {first, rest...};
+            return Promise<void>(Promise<boost::blank>::all_impl(promises, promises+1+sizeof...(rest)));
+        }
+
+        //Wait for first fulfilled promise of range (Rejects with "AggregateError" if all are rejected)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<void> any(It first, It last)
+        {   return Promise<void>(Promise<boost::blank>::any_impl(first, last));
+        }
+
+        template <typename... PT>
+        static Promise<void> any(Promise<void> first, PT... rest)
+        {   Promise<void> promises[] = {first, rest...};
+            return Promise<void>(Promise<boost::blank>::any_impl(promises, promises+1+sizeof...(rest)));
+        }
+
+        //Wait for first settled promise of range (Never settles if range is empty)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<void> race(It first, It last)
+        {   return Promise<void>(Promise<boost::blank>::race_impl(first, last));
+        }
+
+        template <typename... PT>
+        static Promise<void> race(Promise<void> first, PT... rest)
+        {   Promise<void> promises[] = {first, rest...};
+            return Promise<void>(Promise<boost::blank>::race_impl(promises, promises+1+sizeof...(rest)));
+        }
+
+        //Wait for all promises of range to settle (Resolves with results in input order)
+        template <typename It, typename = EnableRange<It>>
+        static Promise<std::vector<PromiseResult<void>>> all_settled(It first, It last)
+        {   return Promise<boost::blank>::all_settled_impl(first, last);
+        }
+
+        template <typename... PT>
+        static Promise<std::vector<PromiseResult<void>>> all_settled(Promise<void> first, PT... rest)
+        {   Promise<void> promises[] = {first, rest...};
+            return Promise<boost::blank>::all_settled_impl(promises, promises+1+sizeof...(rest));
+        }
+
+        //Settle with this promise, or reject with "CancelledError" if token is cancelled first
+        Promise<void> cancel_on(CancelToken token)
+        {   return Promise<void>(Promise<boost::blank>::cancel_on(token));
+        }
+
         //Then
         template <typename U, typename FF>
         Promise<U> then(FF fulfilled)
@@ -504,31 +1228,34 @@ namespace libasync
                 "Fulfilled callback must not have any arguments."
             );
 
-            return Promise<boost::blank>::then<U>([=](boost::blank _) mutable
-            {   return fulfilled();
-            });
+            return Promise<boost::blank>::then<U>(VoidFulfilledWrapper<FF>{std::move(fulfilled)});
         }
 
         template <typename U, typename FF, typename RF>
         Promise<U> then(FF fulfilled, RF rejected)
-        {   this->then<U>(fulfilled);
-            this->_catch<U>(rejected);
+        {   static_assert(
+                FnTrait<FF>::n_args==0,
+                "Fulfilled callback must not have any arguments."
+            );
+
+            return Promise<boost::blank>::then<U>(VoidFulfilledWrapper<FF>{std::move(fulfilled)}, std::move(rejected));
         }
 
         //Catch
         template <typename U, typename RF>
         Promise<U> _catch(RF rejected)
-        {   return Promise<boost::blank>::_catch<U>(rejected);
+        {   return Promise<boost::blank>::_catch<U>(std::move(rejected));
         }
     };
 
     //Fulfilled callback helper
     template <typename U, typename RT, typename T, typename FF>
     struct promise::FulfilledHelper
-    {   //Run fulfilled handler
-        static Promise<U> run(T value, FF fulfilled)
-        {   try
-            {   return Promise<U>::resolved(fulfilled(value));
+    {   //Run fulfilled handler (Value is moved to it if allowed and taken by value or rvalue reference)
+        static Promise<U> run(T& value, bool movable, FF& fulfilled)
+        {   typedef typename FnTrait<FF>::template Arg<0>::Type ArgType;
+            try
+            {   return Promise<U>::resolved(fulfilled(promise::ValuePass<T, ArgType>::pass(value, movable)));
             }
             catch (...)
             {   return Promise<U>::rejected(std::current_exception());
@@ -539,9 +1266,10 @@ namespace libasync
     template <typename T, typename FF>
     struct promise::FulfilledHelper<void, void, T, FF>
     {   //Run fulfilled handler
-        static Promise<void> run(T value, FF fulfilled)
-        {   try
-            {   fulfilled(value);
+        static Promise<void> run(T& value, bool movable, FF& fulfilled)
+        {   typedef typename FnTrait<FF>::template Arg<0>::Type ArgType;
+            try
+            {   fulfilled(promise::ValuePass<T, ArgType>::pass(value, movable));
                 return Promise<void>::resolved();
             }
             catch (...)
@@ -554,7 +1282,7 @@ namespace libasync
     template <typename U, typename RT, typename ET, typename RF>
     struct promise::RejectedHelper
     {   //Run rejected handler
-        static Promise<U> run(ET error, RF rejected)
+        static Promise<U> run(ET error, RF& rejected)
         {   try
             {   return Promise<U>::resolved(rejected(error));
             }
@@ -567,7 +1295,7 @@ namespace libasync
     template <typename ET, typename RF>
     struct promise::RejectedHelper<void, void, ET, RF>
     {   //Run rejected handler
-        static Promise<void> run(ET error, RF rejected)
+        static Promise<void> run(ET error, RF& rejected)
         {   try
             {   rejected(error);
                 return Promise<void>::resolved();
@@ -1,24 +1,210 @@
 #pragma once
 
 #include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
 #include <exception>
+#include <memory>
 
 namespace libasync
 {   //Reactor target
+    class ReactorTarget;
+
+    //Reactor namespace
+    namespace reactor
+    {   //Call event handler of reactor target
+        void dispatch(ReactorTarget* target, void* event);
+        //Release reactor target after unregistration
+        void release(ReactorTarget* target);
+    }
+
+    //Reactor target
     class ReactorTarget
     {protected:
         //React to event
         virtual void reactor_on_event(void* event) = 0;
+        //Release target after unregistration (Deletes target by default)
+        virtual void reactor_release()
+        {   delete this;
+        }
 
-        //Friend function
+        //Friend functions
         friend void reactor_task();
+        friend void reactor::dispatch(ReactorTarget* target, void* event);
+        friend void reactor::release(ReactorTarget* target);
     public:
+        //Operations in flight (Used by completion-based reactors)
+        size_t reactor_n_ops;
+        //Unregistered while operations are in flight (Used by completion-based reactors)
+        bool reactor_unregistered;
+
+        //Constructor
+        ReactorTarget() : reactor_n_ops(0), reactor_unregistered(false) {}
         //Virtual destructor
         virtual ~ReactorTarget() {}
     };
 
+    //Reactor target embedded in data of a handle class
+    //(Holds a reference to data while registered, so registering allocates nothing)
+    template <typename Handle, typename Data>
+    class ReactorSlot : public ReactorTarget
+    {   //Registered data
+        std::shared_ptr<Data> self;
+    protected:
+        //React to event through a handle
+        //(Handle keeps data alive even if handler unregisters it)
+        void reactor_on_event(void* event)
+        {   Handle handle(this->self);
+            handle.reactor_on_event(event);
+        }
+
+        //Drop reference to data (Data and this slot may be destroyed)
+        void reactor_release()
+        {   std::shared_ptr<Data> data;
+            data.swap(this->self);
+        }
+    public:
+        //Attach data and get reactor target for registration
+        ReactorTarget* attach(std::shared_ptr<Data> data)
+        {   this->self = data;
+            return this;
+        }
+    };
+
+    //Default minimum event batch size
+    static const size_t REACTOR_MIN_BATCH = 64;
+    //Default maximum event batch size
+    static const size_t REACTOR_MAX_BATCH = 1024;
+    //Default bytes read from a socket per event
+    static const size_t REACTOR_READ_BUDGET = 64*1024;
+
+    //Reactor wait policy
+    struct ReactorPolicy
+    {   //Minimum event batch size
+        size_t min_batch;
+        //Maximum event batch size (Batch grows when a wait fills it)
+        size_t max_batch;
+        //Time to keep polling without blocking after last event (Microseconds)
+        unsigned int spin_us;
+        //Socket busy polling time (Microseconds; Linux only)
+        unsigned int busy_poll_us;
+        //Bytes read from a socket per event (0 for unlimited)
+        //(Sockets with data left are served again in next reactor round, after other ready sockets)
+        size_t read_budget;
+
+        //Constructor
+        ReactorPolicy() : min_batch(REACTOR_MIN_BATCH), max_batch(REACTOR_MAX_BATCH), spin_us(0), busy_poll_us(0),
+            read_budget(REACTOR_READ_BUDGET) {}
+    };
+
+    //Reactor histogram (Log-linear buckets with 12.5% relative precision)
+    struct ReactorHistogram
+    {   //Sub-bucket bits per power of 2
+        static const unsigned SUB_BITS = 3;
+        //Bucket amount
+        static const unsigned N_BUCKETS = (64-SUB_BITS+1)<<SUB_BITS;
+
+        //Bucket counts
+        uint64_t buckets[N_BUCKETS];
+        //Amount of recorded values
+        uint64_t count;
+        //Sum of recorded values
+        uint64_t sum;
+        //Maximum recorded value
+        uint64_t max;
+
+        //Constructor
+        ReactorHistogram();
+
+        //Record a value
+        void record(uint64_t value);
+        //Get value at given quantile (0 to 1; Lower bound of its bucket)
+        uint64_t quantile(double q) const;
+        //Get mean of recorded values
+        double mean() const;
+    };
+
+    //Reactor statistics
+    struct ReactorStats
+    {   //Amount of reactor waits
+        uint64_t n_waits;
+        //Amount of events returned by waits
+        uint64_t n_events;
+        //Amount of event handler calls
+        uint64_t n_dispatches;
+        //Amount of system calls issued by reactor, sockets, fd watchers and signal handling
+        uint64_t n_syscalls;
+
+        //Time spent in each wait (Nanoseconds; Recorded if timing is enabled)
+        ReactorHistogram wait_ns;
+        //Events returned by each wait
+        ReactorHistogram events_per_wait;
+        //Time spent in each event handler call (Nanoseconds; Recorded if timing is enabled)
+        ReactorHistogram dispatch_ns;
+        //System calls issued in each reactor round
+        ReactorHistogram syscalls_per_round;
+
+        //Constructor
+        ReactorStats() : n_waits(0), n_events(0), n_dispatches(0), n_syscalls(0) {}
+    };
+
+    //Reactor namespace
+    namespace reactor
+    {   //Reactor wait state type
+        struct WaitState
+        {   //Wait policy
+            ReactorPolicy policy;
+            //Current event batch size
+            size_t batch_size;
+            //Amount of consecutive waits using less than a quarter of batch
+            size_t n_underused;
+            //Time of last event
+            std::chrono::steady_clock::time_point last_event;
+            //Task loop entered sleeping state for current wait
+            bool sleeping;
+            //Record wait and dispatch time
+            bool timing;
+            //Start time of current wait (Nanoseconds)
+            uint64_t wait_start;
+            //System call count at start of current round
+            uint64_t round_syscalls;
+
+            //Constructor
+            WaitState() : batch_size(REACTOR_MIN_BATCH), n_underused(0), sleeping(false), timing(false), wait_start(0), round_syscalls(0) {}
+        };
+
+        //Reactor wait state
+        extern thread_local WaitState wait_state;
+        //Reactor statistics
+        extern thread_local ReactorStats stats;
+
+        //Count system calls issued
+        inline void count_syscall(uint64_t n = 1)
+        {   stats.n_syscalls += n;
+        }
+
+        //Get timeout for next reactor wait (Milliseconds; -1 for infinite)
+        //(Task loop enters sleeping state if wait may block; never blocks if targets are ready)
+        int wait_timeout(bool ready = false);
+        //Update wait state with amount of events returned by last wait
+        void wait_done(size_t n_events);
+        //Enable socket busy polling if requested by wait policy (Linux only)
+        void set_busy_poll(int fd);
+    }
+
     //Reactor module initialization
     void reactor_init();
+    //Set reactor wait policy for current thread
+    void reactor_set_policy(ReactorPolicy policy);
+    //Get reactor wait policy of current thread
+    ReactorPolicy reactor_policy();
+    //Enable or disable wait and dispatch timing for current thread
+    void reactor_set_timing(bool enabled);
+    //Get snapshot of reactor statistics of current thread
+    ReactorStats reactor_stats();
+    //Reset reactor statistics of current thread
+    void reactor_reset_stats();
     //Reactor task
     void reactor_task();
     //Unregister object from reactor
@@ -31,7 +217,8 @@ namespace libasync
         enum class Reason
         {   INIT,
             QUERY,
-            REG
+            REG,
+            MODIFY
         };
 
         //Constructor
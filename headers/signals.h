@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <signal.h>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <libasync/promise.h>
+
+namespace libasync
+{   //Signal handler type
+    typedef std::function<void(int)> SignalHandler;
+
+    //Signal namespace
+    namespace signals
+    {   //Signal data type
+        struct SignalData
+        {   //Handlers of each signal
+            //(Ordered by handle, so handlers are called in registration order)
+            std::unordered_map<int, std::map<size_t, SignalHandler>> handlers;
+            //Handle counter
+            size_t counter;
+
+            //Constructor
+            SignalData() : counter(0) {}
+        };
+
+        //Signal data of current thread
+        extern thread_local SignalData* signal_data;
+
+        //Call handlers of given signal
+        void dispatch(int signum);
+
+        //Start receiving signal through reactor (Platform-specific)
+        void signal_watch(int signum);
+        //Stop receiving signal through reactor (Platform-specific)
+        void signal_unwatch(int signum);
+
+        //Signal block scope
+        //(Blocks asynchronous signals in current thread until destroyed; threads started meanwhile inherit the mask)
+        class BlockScope
+        {   //Previous signal mask
+            sigset_t old_mask;
+        public:
+            //Constructor
+            BlockScope();
+            //Destructor
+            ~BlockScope();
+        };
+    }
+
+    //Add signal handler on current thread (Returns handle for removal)
+    //(Signal is no longer delivered to its disposition while handled)
+    //(Linux: signal masks are per thread; every thread other than the handling one must block the signal, or
+    // the kernel may deliver it there instead. Library threads block asynchronous signals from the start; block
+    // handled signals in own threads, e.g. by adding handlers before starting them)
+    size_t on_signal(int signum, SignalHandler handler);
+    //Remove signal handler
+    bool off_signal(int signum, size_t handle);
+    //Wait for next delivery of given signal
+    Promise<int> next_signal(int signum);
+}
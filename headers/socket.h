@@ -1,11 +1,16 @@
 #pragma once
 
 #include <netinet/in.h>
+#include <atomic>
 #include <memory>
 #include <exception>
+#include <functional>
 #include <string>
-#include <queue>
+#include <list>
+#include <vector>
+#include <libasync/cancel.h>
 #include <libasync/promise.h>
+#include <libasync/taskloop.h>
 #include <libasync/event.h>
 #include <libasync/reactor.h>
 
@@ -14,7 +19,7 @@ namespace libasync
     static const size_t SOCK_BUFFER_SIZE = 1024;
 
     //Socket class
-    class Socket : public EventMixin, public ReactorTarget
+    class Socket : public EventMixin
     {public:
         //Socket status
         enum class Status
@@ -27,13 +32,20 @@ namespace libasync
     private:
         //Promise queue item
         struct PromiseQueueItem
-        {   //Write target
+        {   //Write start (Bytes written when first byte of this write is sent)
+            size_t start;
+            //Write target
             size_t target;
             //Promise context
             PromiseCtx<void> ctx;
+            //Write identifier
+            uint64_t id;
+            //Cancel callback registration (Removed from token when item is released; null if not cancellable)
+            std::shared_ptr<void> cancel_reg;
 
             //Constructor
-            PromiseQueueItem(size_t _target, PromiseCtx<void> _ctx) : target(_target), ctx(_ctx) {}
+            PromiseQueueItem(size_t _start, size_t _target, PromiseCtx<void> _ctx, uint64_t _id) : start(_start),
+                target(_target), ctx(_ctx), id(_id) {}
         };
 
         //Socket data type
@@ -45,13 +57,18 @@ namespace libasync
 
             //Data buffer (Used for writing data)
             std::string buffer;
+            //Data buffer being sent (Used by completion-based reactors)
+            std::string send_buffer;
             //Bytes read
             size_t bytes_read;
             //Bytes written
             size_t bytes_written;
 
             //Write promise queue
-            std::queue<PromiseQueueItem> write_promise_queue;
+            //(List-based; an empty deque would allocate, and cancelled writes are removed from the middle)
+            std::list<PromiseQueueItem> write_promise_queue;
+            //Next write identifier
+            uint64_t next_write_id;
 
             //Local address
             in_addr_t local_addr;
@@ -61,9 +78,24 @@ namespace libasync
             in_addr_t remote_addr;
             //Remote port
             in_port_t remote_port;
+            //Remote address object (Used by completion-based reactors)
+            sockaddr_in remote_addr_obj;
+            //Worker load token (Released when connection closes to update worker load)
+            std::shared_ptr<void> load_token;
+
+            //Reactor registration data (Platform-specific)
+            uint64_t reg_data;
+            //Write readiness watched (Readiness-based reactors arm it only while connecting or data is pending)
+            bool write_interest;
+
+            //Event mix-in data
+            EventMixinData events;
+            //Reactor target
+            ReactorSlot<Socket, SocketData> reactor_slot;
 
             //Constructor
-            SocketData() : status(Status::IDLE), bytes_read(0), bytes_written(0), local_addr(INADDR_NONE) {}
+            SocketData() : status(Status::IDLE), bytes_read(0), bytes_written(0), next_write_id(0),
+                local_addr(INADDR_NONE), reg_data(0), write_interest(false) {}
         };
 
         //Socket data reference type
@@ -74,14 +106,34 @@ namespace libasync
 
         //Internal constructor
         Socket(int fd);
+        //Internal constructor (Handle of existing data)
+        Socket(SocketDataRef _data);
 
         //Shared socket initialization logic
         void create();
         //Register socket to reactor
         void reactor_register();
+        //Connect to remote address (Platform-specific)
+        bool reactor_connect(const sockaddr_in& addr_obj);
+        //Write buffered data to socket (Platform-specific)
+        bool reactor_write();
+        //Close socket file descriptor (Platform-specific)
+        void reactor_close();
+        //Resolve write promises whose target is reached
+        void resolve_writes();
+
+        //Connect to given address and port (Implementation; token may be null)
+        Promise<void> connect_impl(in_addr_t addr, in_port_t port, CancelToken* token);
+        //Write data to socket (Implementation; token may be null)
+        Promise<void> write_impl(std::string data, CancelToken* token);
+        //Abort connecting (Closes socket file descriptor)
+        void abort_connect();
+        //Cancel pending write (Drops its unsent bytes)
+        void cancel_write(uint64_t id);
 
         //Friend classes
         friend class ServerSocket;
+        friend class ReactorSlot<Socket, SocketData>;
     protected:
         //Respond to event
         void reactor_on_event(void* event);
@@ -98,8 +150,12 @@ namespace libasync
         void bind(in_addr_t addr, in_port_t port);
         //Connect to given address and port
         Promise<void> connect(in_addr_t addr, in_port_t port);
+        //Connect to given address and port (Cancelling token while connecting closes socket)
+        Promise<void> connect(in_addr_t addr, in_port_t port, CancelToken token);
         //Write data to socket
         Promise<void> write(std::string data);
+        //Write data to socket (Cancelling token drops bytes of this write not yet handed to system)
+        Promise<void> write(std::string data, CancelToken token);
         //Close connection
         void close();
 
@@ -115,7 +171,7 @@ namespace libasync
     };
 
     //Server socket class
-    class ServerSocket : public EventMixin, public ReactorTarget
+    class ServerSocket : public EventMixin
     {public:
         //Socket status
         enum class Status
@@ -123,7 +179,18 @@ namespace libasync
             LISTENING,
             CLOSED
         };
+        //Connection dispatch policy
+        enum class Dispatch
+        {   ROUND_ROBIN,
+            LEAST_CONNECTIONS,
+            HASH
+        };
+        //Connection handler type (Used with worker loops)
+        typedef std::function<void(Socket)> ConnectHandler;
     private:
+        //Worker load type (Live connections of each worker)
+        typedef std::vector<std::atomic<size_t>> WorkerLoad;
+
         //Server socket data type
         struct ServerSocketData
         {   //Socket file descriptor
@@ -136,8 +203,29 @@ namespace libasync
             //Local port
             in_addr_t local_port;
 
+            //Accepted client address (Used by completion-based reactors)
+            sockaddr_in accept_addr;
+            //Accepted client address length
+            socklen_t accept_addr_len;
+
+            //Worker loops accepted connections are handed off to (Empty to keep them on this thread)
+            std::vector<TaskLoop> workers;
+            //Dispatch policy
+            Dispatch dispatch;
+            //Next worker for round-robin dispatching
+            size_t next_worker;
+            //Worker load (Least-connections dispatching only)
+            std::shared_ptr<WorkerLoad> worker_load;
+            //Connection handler of each worker (Each worker calls its own copy only)
+            std::shared_ptr<std::vector<ConnectHandler>> worker_handlers;
+
+            //Event mix-in data
+            EventMixinData events;
+            //Reactor target
+            ReactorSlot<ServerSocket, ServerSocketData> reactor_slot;
+
             //Constructor
-            ServerSocketData() : status(Status::IDLE) {}
+            ServerSocketData() : status(Status::IDLE), dispatch(Dispatch::ROUND_ROBIN), next_worker(0) {}
         };
 
         //Server socket data reference type
@@ -146,8 +234,18 @@ namespace libasync
         //Server socket data
         ServerSocketDataRef data;
 
+        //Internal constructor (Handle of existing data)
+        ServerSocket(ServerSocketDataRef _data);
+
         //Register socket to reactor
         void reactor_register();
+        //Handle accepted connection
+        void accepted(int client_fd, const sockaddr_in& client_addr);
+        //Select worker for accepted connection
+        size_t select_worker(const sockaddr_in& client_addr);
+
+        //Friend classes
+        friend class ReactorSlot<ServerSocket, ServerSocketData>;
     protected:
         //Respond to event
         void reactor_on_event(void* event);
@@ -155,8 +253,15 @@ namespace libasync
         //Constructor
         ServerSocket();
 
+        //Share listening address with other sockets (SO_REUSEPORT; call before listening)
+        void reuse_port();
+        //Prefer this socket for connections handled on given CPU (SO_INCOMING_CPU; Linux only)
+        void incoming_cpu(int cpu);
         //Listen
         void listen(in_addr_t addr, in_port_t port, int backlog = SOMAXCONN);
+        //Hand accepted connections off to worker loops (Call before listening)
+        //(Workers must have reactor initialized; each worker calls its own copy of handler instead of "connect" event)
+        void dispatch(std::vector<TaskLoop> workers, ConnectHandler handler, Dispatch policy = Dispatch::ROUND_ROBIN);
         //Close connection
         void close();
 
@@ -174,6 +279,8 @@ namespace libasync
         {   CREATE,
             MAKE_NON_BLOCK,
             REUSEADDR,
+            REUSEPORT,
+            INCOMING_CPU,
             BIND,
             LISTEN,
             CONNECT,
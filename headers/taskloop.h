@@ -1,22 +1,123 @@
 #pragma once
 
-#include <functional>
-#include <list>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <libasync/callable.h>
 
 namespace libasync
 {   //Task loop class
     class TaskLoop
     {public:
         //Task type
-        typedef std::function<void()> Task;
+        typedef Callable<void()> Task;
+        //Permanent task handle type (Slot index in lower and generation in upper 32 bits)
+        typedef uint64_t TaskHandle;
+        //Wakeup callback type (Called from posting thread)
+        typedef void (*Waker)(void* arg);
+        //Idle check type (Returns milliseconds loop may sleep; 0 if work is pending, -1 for no limit)
+        typedef int (*IdleCheck)(void* arg);
+
+        //Oneshot task priority (Each priority has its own lane, run in this order)
+        enum class Priority
+        {   URGENT,
+            NORMAL,
+            BACKGROUND
+        };
+        //Amount of priority lanes
+        static const size_t N_PRIORITIES = 3;
     private:
+        //Task ring buffer type (Contiguous; tasks are moved in and out, never copied)
+        struct TaskRing
+        {   //Task slots (Capacity is a power of 2)
+            std::vector<Task> slots;
+            //Index of first task
+            size_t head;
+            //Amount of tasks
+            size_t count;
+
+            //Constructor
+            TaskRing();
+
+            //Append task to ring (Grows ring if full)
+            void push(Task&& task);
+            //Move first task out of ring
+            void pop(Task& task);
+        };
+
+        //Permanent task slot type
+        struct PermanentSlot
+        {   //Task (Empty if slot is free)
+            Task task;
+            //Slot generation (Changed when task is removed, invalidating its handle)
+            uint32_t generation;
+            //Task paused
+            bool paused;
+            //Task removed while running (Released after it returns)
+            bool removed;
+
+            //Constructor
+            PermanentSlot() : generation(1), paused(false), removed(false) {}
+        };
+
+        //Posted task node type
+        struct PostNode
+        {   //Next node
+            std::atomic<PostNode*> next;
+            //Task
+            Task task;
+            //Task priority
+            Priority priority;
+
+            //Constructor
+            PostNode() : next(nullptr), priority(Priority::NORMAL) {}
+        };
+
         //Task loop data type
         struct TaskLoopData
-        {   //Permanent task queue
-            std::list<Task> permanent_queue;
-            //Oneshot task queue
-            std::list<Task> oneshot_queue;
+        {   //Permanent task slots
+            //(Appending never relocates tasks, so a running task may add another)
+            std::deque<PermanentSlot> permanent_queue;
+            //Free permanent task slots
+            std::vector<uint32_t> permanent_free;
+            //Amount of permanent tasks
+            size_t n_permanent;
+            //Slot of permanent task being run (-1 if none)
+            long current_slot;
+            //Oneshot task lanes (Indexed by priority)
+            TaskRing oneshot_lanes[N_PRIORITIES];
+            //Maximum tasks run from each lane per round (0 for no limit)
+            size_t lane_budgets[N_PRIORITIES];
+            //Amount of oneshot tasks in all lanes
+            size_t n_oneshot;
+
+            //Posted task queue head (Pushed by any thread)
+            std::atomic<PostNode*> post_head;
+            //Posted task queue tail (Consumed node; popped by loop thread only)
+            PostNode* post_tail;
+            //Loop is blocked waiting for events
+            std::atomic<bool> sleeping;
+            //Loop is running (Until stopped)
+            bool running;
+            //Wakeup callback and its argument
+            Waker waker;
+            void* waker_arg;
+            //Idle checks of modules and their arguments
+            std::vector<std::pair<IdleCheck, void*>> idle_checks;
+            //Idle wait lock and condition (Used by "run()" without a wakeup callback)
+            std::mutex idle_lock;
+            std::condition_variable idle_cond;
+
+            //Constructor
+            TaskLoopData();
+            //Destructor
+            ~TaskLoopData();
         };
 
         //Task loop data reference type
@@ -30,6 +131,15 @@ namespace libasync
 
         //Internal constructor
         TaskLoop(TaskLoopDataRef _data);
+
+        //Find permanent task slot by handle (Null if handle is stale)
+        PermanentSlot* find_slot(TaskHandle handle);
+        //Release slot of removed permanent task
+        void release_slot(uint32_t index);
+        //Sleep until woken up or idle timeout (Used without a wakeup callback)
+        void idle_wait();
+        //Queue oneshot task to lane of given priority
+        void push_oneshot(Task&& task, Priority priority);
     public:
         //Constructor
         TaskLoop();
@@ -37,21 +147,49 @@ namespace libasync
         static TaskLoop thread_loop();
 
         //Add a permanent task to queue
-        void add(Task task);
+        TaskHandle add(Task task);
         //Add a oneshot task to queue
-        void oneshot(Task task);
-        //Remove task from queue (Problematic; not implemented)
+        void oneshot(Task task, Priority priority = Priority::NORMAL);
+        //Post a oneshot task to queue from any thread
+        void post(Task task, Priority priority = Priority::NORMAL);
+        //Remove permanent task (Safe from inside any task, including itself)
+        bool remove(TaskHandle handle);
+        //Pause permanent task (Skipped by loop until resumed)
+        bool pause(TaskHandle handle);
+        //Resume paused permanent task
+        bool resume(TaskHandle handle);
 
         //Get amount of permanent tasks
         size_t n_permanent_tasks();
         //Get amount of oneshot tasks
         size_t n_oneshot_tasks();
+        //Get amount of oneshot tasks of given priority
+        size_t n_oneshot_tasks(Priority priority);
+        //Set maximum tasks run from lane of given priority per round (0 for no limit)
+        //(Tasks over budget are left for next round, after permanent tasks and reactor polling)
+        void set_lane_budget(Priority priority, size_t budget);
+        //Get maximum tasks run from lane of given priority per round (0 for no limit)
+        size_t lane_budget(Priority priority);
 
-        //Run loop forever
+        //Run loop until stopped
+        //(Without a reactor, sleeps while idle until a task is posted or idle timeout expires)
         void run();
+        //Stop running loop (Thread-safe)
+        void stop();
         //Run loop once
         void run_once();
         //Synonym for "run_once()"
         void operator()();
+
+        //Set wakeup callback for posted tasks (Called by reactor before other threads post)
+        void set_waker(Waker waker, void* arg);
+        //Add idle check (Called by modules whose work is not visible to loop, E.g. promise callbacks)
+        void add_idle_check(IdleCheck check, void* arg);
+        //Get milliseconds loop may sleep before running again (0 if work is pending; -1 for no limit)
+        int idle_timeout();
+        //Enter sleeping state before blocking (Returns false if oneshot or posted tasks are pending)
+        bool sleep_begin();
+        //Leave sleeping state after blocking
+        void sleep_end();
     };
 }
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <libasync/taskloop.h>
+
+namespace libasync
+{   //Thread pool loop class
+    //(Runs oneshot tasks on worker threads with work stealing; meant for CPU-bound work, I/O stays on reactor threads)
+    class ThreadPoolLoop
+    {public:
+        //Task type
+        typedef TaskLoop::Task Task;
+    private:
+        //Work stealing deque type (Chase-Lev; owner pushes and takes at bottom, others steal from top)
+        class WorkDeque
+        {   //Task array type (Capacity is a power of 2)
+            struct TaskArray
+            {   //Capacity mask
+                int64_t mask;
+                //Task slots
+                std::unique_ptr<std::atomic<Task*>[]> slots;
+
+                //Constructor
+                TaskArray(int64_t capacity);
+
+                //Get task at given index
+                Task* get(int64_t index);
+                //Put task at given index
+                void put(int64_t index, Task* task);
+            };
+
+            //Index of first task (Advanced by thieves and owner taking last task)
+            std::atomic<int64_t> top;
+            //Index after last task (Changed by owner only)
+            std::atomic<int64_t> bottom;
+            //Current task array
+            std::atomic<TaskArray*> array;
+            //Task arrays (Retired ones are kept until destruction, since thieves may still read them)
+            std::vector<std::unique_ptr<TaskArray>> arrays;
+
+            //Grow task array (Owner only)
+            TaskArray* grow(TaskArray* old, int64_t top, int64_t bottom);
+        public:
+            //Constructor
+            WorkDeque();
+            //Destructor
+            ~WorkDeque();
+
+            //Push task at bottom (Owner only)
+            void push(Task* task);
+            //Take task from bottom (Owner only; null if empty)
+            Task* take();
+            //Steal task from top (Any thread; null if empty or lost a race)
+            Task* steal();
+            //Check if deque looks empty
+            bool empty();
+        };
+
+        //Thread pool loop data type (Kept alive by handles and by each thread until it exits)
+        struct ThreadPoolData
+        {   //Threads
+            std::vector<std::thread> threads;
+            //Work deque of each thread
+            std::vector<std::unique_ptr<WorkDeque>> deques;
+            //Loop is running (Until stopped)
+            std::atomic<bool> running;
+
+            //Lock for fields below
+            std::mutex lock;
+            //Condition variable for sleeping threads
+            std::condition_variable cond;
+            //Tasks posted from other threads
+            std::deque<Task> inject_queue;
+            //Amount of tasks in inject queue (Checked without lock)
+            std::atomic<size_t> n_injected;
+            //Amount of sleeping threads (Changed with lock held)
+            std::atomic<size_t> n_sleeping;
+            //Wakeup sequence number (Advanced to wake up sleeping threads)
+            uint64_t wake_seq;
+
+            //Constructor
+            ThreadPoolData() : running(true), n_injected(0), n_sleeping(0), wake_seq(0) {}
+        };
+
+        //Thread pool loop data reference type
+        typedef std::shared_ptr<ThreadPoolData> ThreadPoolDataRef;
+
+        //Thread pool loop release type (Deleter of handle references; stops threads once all handles are released)
+        struct ThreadPoolRelease
+        {   //Data reference (Dropped after threads are stopped)
+            ThreadPoolDataRef data;
+
+            //Stop threads
+            void operator()(ThreadPoolData* data);
+        };
+
+        //Pool of current thread (Null if not a worker thread)
+        static thread_local ThreadPoolData* thread_pool;
+        //Worker index of current thread
+        static thread_local size_t thread_index;
+
+        //Thread pool loop data (Shared by handles)
+        ThreadPoolDataRef data;
+
+        //Thread main function
+        static void thread_main(ThreadPoolDataRef data_ref, size_t index);
+        //Find a task to run (Own deque, then inject queue, then other deques)
+        static Task* find_task(ThreadPoolData* data, size_t index);
+        //Wake up sleeping threads if any
+        static void wakeup(ThreadPoolData* data, bool all = false);
+        //Wakeup callback of worker task loops
+        static void loop_wakeup(void* arg);
+    public:
+        //Constructor (Zero threads means one thread per CPU)
+        ThreadPoolLoop(size_t n_threads = 0);
+
+        //Post a oneshot task from any thread
+        //(From a worker of this pool the task goes to its own deque; otherwise to the shared inject queue)
+        void post(Task task);
+        //Get amount of threads
+        size_t size();
+        //Get worker index of current thread (-1 if not a worker of this pool)
+        long worker_index();
+
+        //Stop all threads (Queued tasks are discarded)
+        void stop();
+        //Wait for all threads to exit
+        void join();
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <libasync/promise.h>
+#include <libasync/taskloop.h>
+
+namespace libasync
+{   //Timer clock type
+    typedef std::chrono::steady_clock TimerClock;
+    //Timer deadline type
+    typedef TimerClock::time_point Deadline;
+
+    //Timer class
+    class Timer;
+
+    //Timer namespace
+    namespace timer
+    {   //Timing wheel bits per level
+        static const unsigned WHEEL_BITS = 6;
+        //Timing wheel slots per level
+        static const unsigned WHEEL_SIZE = 1<<WHEEL_BITS;
+        //Timing wheel levels
+        static const unsigned WHEEL_LEVELS = 5;
+
+        //Intrusive timer list link
+        struct TimerLink
+        {   //Previous node
+            TimerLink* prev;
+            //Next node
+            TimerLink* next;
+        };
+
+        //Hierarchical timing wheel type
+        struct TimerWheel;
+
+        //Timing wheel of current thread
+        extern thread_local TimerWheel* timer_wheel;
+
+        //Get milliseconds until next timer event (-1 if no timer is pending)
+        int next_timeout();
+        //Timer task
+        void timer_task();
+
+        //Sleep for given milliseconds
+        Promise<void> sleep(unsigned long ms);
+        //Sleep until given deadline
+        Promise<void> at(Deadline deadline);
+    }
+
+    //Initialize timer module for current thread
+    void timer_init();
+
+    //Timer class
+    class Timer
+    {public:
+        //Timer callback type
+        typedef TaskLoop::Task Callback;
+    private:
+        //Timer data type
+        struct TimerData : public timer::TimerLink
+        {   //Deadline
+            Deadline deadline;
+            //Expiry tick
+            uint64_t expiry;
+            //Timing wheel slot (-1 if not scheduled)
+            int slot;
+            //Callback
+            Callback callback;
+            //Self reference (Held while scheduled)
+            std::shared_ptr<TimerData> self;
+        };
+
+        //Timer data reference type
+        typedef std::shared_ptr<TimerData> TimerDataRef;
+
+        //Timer data
+        TimerDataRef data;
+
+        //Friend classes
+        friend struct timer::TimerWheel;
+    public:
+        //Construct a timer expiring at given deadline
+        Timer(Deadline deadline, Callback callback);
+        //Construct a timer expiring after given milliseconds
+        Timer(unsigned long ms, Callback callback);
+
+        //Cancel timer
+        bool cancel();
+        //Check if timer is still pending
+        bool pending();
+        //Get deadline
+        Deadline deadline();
+    };
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <libasync/event.h>
+#include <libasync/reactor.h>
+
+namespace libasync
+{   //File descriptor watcher class
+    //(Watches a file descriptor owned by caller; it is never closed by watcher)
+    class FdWatcher : public EventMixin
+    {public:
+        //Trigger mode
+        enum class Mode
+        {   LEVEL,
+            EDGE
+        };
+    private:
+        //File descriptor watcher data type
+        struct FdWatcherData
+        {   //Watched file descriptor
+            int fd;
+            //Trigger mode
+            Mode mode;
+            //Watch readability
+            bool readable;
+            //Watch writability
+            bool writable;
+            //Registered to reactor
+            bool active;
+            //Reactor registration data (Platform-specific)
+            uint64_t reg_data;
+
+            //Event mix-in data
+            EventMixinData events;
+            //Reactor target
+            ReactorSlot<FdWatcher, FdWatcherData> reactor_slot;
+
+            //Constructor
+            FdWatcherData() : active(false), reg_data(0) {}
+        };
+
+        //File descriptor watcher data reference type
+        typedef std::shared_ptr<FdWatcherData> FdWatcherDataRef;
+
+        //File descriptor watcher data
+        FdWatcherDataRef data;
+
+        //Internal constructor (Handle of existing data)
+        FdWatcher(FdWatcherDataRef _data);
+
+        //Register watcher to reactor (Platform-specific)
+        void reactor_register();
+        //Update watched events in reactor (Platform-specific)
+        void reactor_update();
+        //Unregister watcher from reactor (Platform-specific)
+        void reactor_stop();
+
+        //Friend classes
+        friend class ReactorSlot<FdWatcher, FdWatcherData>;
+    protected:
+        //Respond to event
+        void reactor_on_event(void* event);
+    public:
+        //Constructor
+        FdWatcher(int fd, bool readable = true, bool writable = false, Mode mode = Mode::LEVEL);
+
+        //Change watched events
+        void watch(bool readable, bool writable);
+        //Stop watching
+        void stop();
+
+        //Get watched file descriptor
+        int fd();
+        //Check if watcher is active
+        bool active();
+    };
+}
@@ -1,6 +1,9 @@
+#include <errno.h>
 #include <unistd.h>
 #include <sys/event.h>
+#include <algorithm>
 #include <libasync/reactor.h>
+#include <libasync/signals.h>
 #include <libasync/taskloop.h>
 #include <libasync/FreeBSD/reactor.h>
 
@@ -8,11 +11,33 @@ namespace libasync
 {   //Kqueue data
     thread_local KqueueData* kqueue_data = nullptr;
 
+    //Wake up reactor blocked in another thread
+    static void kqueue_wakeup(void* arg)
+    {   struct kevent trigger_event;
+
+        EV_SET(&trigger_event, KQUEUE_WAKEUP_IDENT, EVFILT_USER, 0, NOTE_TRIGGER, 0, nullptr);
+        kevent(int(intptr_t(arg)), &trigger_event, 1, nullptr, 0, &zero_time);
+    }
+
     //Reactor task
     void reactor_task()
-    {   //Wait for kevents
-        int n_events = kevent(kqueue_data->fd, nullptr, 0, kqueue_data->events, KEVENT_BUFFER_SIZE, &zero_time);
-        if (n_events==-1)
+    {   auto& events = kqueue_data->events;
+        //Resize events buffer to current batch size
+        if (events.size()!=reactor::wait_state.batch_size)
+            events.resize(reactor::wait_state.batch_size);
+
+        //Wait for kevents until next timer event
+        int timeout = reactor::wait_timeout();
+        timespec timeout_obj;
+        timeout_obj.tv_sec = timeout/1000;
+        timeout_obj.tv_nsec = (timeout%1000)*1000000;
+
+        int n_events = kevent(kqueue_data->fd, nullptr, 0, events.data(), events.size(), (timeout<0)?nullptr:&timeout_obj);
+        reactor::wait_done(std::max(n_events, 0));
+        //Interrupted by signal
+        if ((n_events==-1)&&(errno==EINTR))
+            return;
+        else if (n_events==-1)
         {   ::close(kqueue_data->fd);
             throw ReactorError(ReactorError::Reason::QUERY);
         }
@@ -20,16 +45,34 @@ namespace libasync
         //Demultiplex events
         for (unsigned int i=0;i<n_events;i++)
         {   //Event object pointer
-            auto event_ptr = kqueue_data->events+i;
+            auto event_ptr = &events[i];
+            //Woken up by posting thread (User event is cleared automatically)
+            if (event_ptr->filter==EVFILT_USER)
+                continue;
+            //Signal delivered (Identifier is signal number)
+            else if (event_ptr->filter==EVFILT_SIGNAL)
+            {   signals::dispatch(event_ptr->ident);
+                continue;
+            }
             //Lookup for reactor target
-            //(Ignore if file descriptor not in table; why is it happening?)
-            auto table_pair_ptr = kqueue_data->table.find(event_ptr->ident);
-            if (table_pair_ptr==kqueue_data->table.end())
+            //(User data holds registration generation)
+            size_t fd = event_ptr->ident;
+            uint32_t generation = uintptr_t(event_ptr->udata);
+            //(Ignore stale events of unregistered targets)
+            if (fd>=kqueue_data->table.size())
+                continue;
+            auto& entry = kqueue_data->table[fd];
+            if ((!entry.target)||(entry.generation!=generation))
                 continue;
 
             //Call event handler
-            table_pair_ptr->second->reactor_on_event(event_ptr);
+            reactor::dispatch(entry.target, event_ptr);
         }
+
+        //Release unregistered targets
+        for (auto target : kqueue_data->garbage)
+            reactor::release(target);
+        kqueue_data->garbage.clear();
     }
 
     //Reactor module initialization
@@ -42,19 +85,49 @@ namespace libasync
         if (fd==-1)
             throw ReactorError(ReactorError::Reason::INIT);
         kqueue_data->fd = fd;
+        kqueue_data->generation = 0;
+
+        //Add wakeup user event to kqueue descriptor
+        struct kevent wakeup_event;
+        EV_SET(&wakeup_event, KQUEUE_WAKEUP_IDENT, EVFILT_USER, EV_ADD|EV_CLEAR, 0, 0, nullptr);
+        if (kevent(fd, &wakeup_event, 1, nullptr, 0, &zero_time)<0)
+            throw ReactorError(ReactorError::Reason::INIT);
+        TaskLoop::thread_loop().set_waker(kqueue_wakeup, reinterpret_cast<void*>(intptr_t(fd)));
 
         //Add reactor task to task loop
         TaskLoop::thread_loop().add(reactor_task);
     }
 
+    //Add reactor target to lookup table
+    void* kqueue_table_add(int fd, ReactorTarget* target)
+    {   auto& table = kqueue_data->table;
+
+        //Grow lookup table
+        if (size_t(fd)>=table.size())
+            table.resize(std::max<size_t>(fd+1, table.size()*2), KqueueEntry{nullptr, 0});
+        //Release previous target (File descriptor closed and reused)
+        auto& entry = table[fd];
+        if (entry.target)
+            kqueue_data->garbage.push_back(entry.target);
+
+        //Set target and registration generation
+        entry.target = target;
+        entry.generation = ++kqueue_data->generation;
+
+        return reinterpret_cast<void*>(uintptr_t(entry.generation));
+    }
+
     //Unregister object from reactor
     void reactor_unreg(int fd)
     {   //Find object associated with the file descriptor
-        auto table_pair_ptr = kqueue_data->table.find(fd);
-        if (table_pair_ptr==kqueue_data->table.end())
+        if ((fd<0)||(size_t(fd)>=kqueue_data->table.size()))
+            return;
+        auto& entry = kqueue_data->table[fd];
+        if (!entry.target)
             return;
 
-        delete table_pair_ptr->second;
-        kqueue_data->table.erase(table_pair_ptr);
+        //(Target may be handling an event; release it later)
+        kqueue_data->garbage.push_back(entry.target);
+        entry.target = nullptr;
     }
 }
@@ -0,0 +1,66 @@
+#include <signal.h>
+#include <sys/event.h>
+#include <mutex>
+#include <unordered_map>
+#include <libasync/signals.h>
+#include <libasync/reactor.h>
+#include <libasync/FreeBSD/reactor.h>
+
+namespace libasync
+{   namespace signals
+    {   //Saved signal disposition type
+        struct SavedAction
+        {   //Amount of threads watching signal
+            size_t n_watchers;
+            //Disposition before signal was first watched
+            struct sigaction action;
+        };
+
+        //Saved signal dispositions
+        //(Dispositions are process-wide, while signals are watched per thread)
+        static std::unordered_map<int, SavedAction> saved_actions;
+        //Saved signal dispositions lock
+        static std::mutex saved_actions_lock;
+
+        //Start receiving signal through reactor
+        void signal_watch(int signum)
+        {   struct kevent new_event;
+
+            //Add signal event to kqueue descriptor
+            //(Delivery attempts are recorded even if signal is ignored)
+            EV_SET(&new_event, signum, EVFILT_SIGNAL, EV_ADD|EV_ENABLE, 0, 0, nullptr);
+            reactor::count_syscall();
+            if (kevent(kqueue_data->fd, &new_event, 1, nullptr, 0, &zero_time)<0)
+                throw ReactorError(ReactorError::Reason::REG);
+
+            //Ignore signal, saving disposition of application when first watched
+            std::lock_guard<std::mutex> guard(saved_actions_lock);
+            auto& saved = saved_actions[signum];
+            if ((saved.n_watchers++)==0)
+            {   struct sigaction ignore_action;
+                ignore_action.sa_handler = SIG_IGN;
+                ignore_action.sa_flags = 0;
+                sigemptyset(&ignore_action.sa_mask);
+                sigaction(signum, &ignore_action, &saved.action);
+            }
+        }
+
+        //Stop receiving signal through reactor
+        void signal_unwatch(int signum)
+        {   struct kevent new_event;
+
+            //Restore saved disposition when last watched
+            {   std::lock_guard<std::mutex> guard(saved_actions_lock);
+                auto saved_ptr = saved_actions.find(signum);
+                if ((saved_ptr!=saved_actions.end())&&((--saved_ptr->second.n_watchers)==0))
+                {   sigaction(signum, &saved_ptr->second.action, nullptr);
+                    saved_actions.erase(saved_ptr);
+                }
+            }
+            //Remove signal event
+            EV_SET(&new_event, signum, EVFILT_SIGNAL, EV_DELETE, 0, 0, nullptr);
+            reactor::count_syscall();
+            kevent(kqueue_data->fd, &new_event, 1, nullptr, 0, &zero_time);
+        }
+    }
+}
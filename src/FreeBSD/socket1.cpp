@@ -2,30 +2,44 @@
 #include <sys/event.h>
 #include <sys/socket.h>
 #include <string>
-#include <algorithm>
 #include <libasync/socket.h>
 #include <libasync/taskloop.h>
 #include <libasync/reactor.h>
 #include <libasync/FreeBSD/reactor.h>
 
 namespace libasync
-{   //Socket buffer
-    char sock_buffer[SOCK_BUFFER_SIZE];
+{   //Socket buffer (One per reactor thread)
+    static thread_local char sock_buffer[SOCK_BUFFER_SIZE];
+
+    //Enable or disable write filter
+    static void watch_write(int fd, uint64_t reg_data, bool enabled)
+    {   struct kevent new_event;
+
+        EV_SET(&new_event, fd, EVFILT_WRITE, enabled?EV_ENABLE:EV_DISABLE, 0, 0, reinterpret_cast<void*>(uintptr_t(reg_data)));
+        reactor::count_syscall();
+        if (kevent(kqueue_data->fd, &new_event, 1, nullptr, 0, &zero_time)<0)
+            throw ReactorError(ReactorError::Reason::MODIFY);
+    }
 
     //Register socket to reactor
     void Socket::reactor_register()
-    {   struct kevent new_events[2];
-        int fd = this->data->fd;
+    {   auto data = this->data;
+        struct kevent new_events[2];
+        int fd = data->fd;
 
+        //Add socket to lookup table
+        void* udata = kqueue_table_add(fd, data->reactor_slot.attach(data));
+        data->reg_data = uintptr_t(udata);
         //Set kevent object
-        EV_SET(new_events, fd, EVFILT_READ, EV_ADD|EV_ENABLE, 0, 0, 0);
-        EV_SET(new_events+1, fd, EVFILT_WRITE, EV_ADD|EV_ENABLE, 0, 0, 0);
+        //(Write filter is level-triggered; enabled only while connecting or data is pending)
+        EV_SET(new_events, fd, EVFILT_READ, EV_ADD|EV_ENABLE, 0, 0, udata);
+        EV_SET(new_events+1, fd, EVFILT_WRITE, EV_ADD|EV_DISABLE, 0, 0, udata);
         //Add to kqueue file descriptor
+        reactor::count_syscall();
         if (kevent(kqueue_data->fd, new_events, 2, nullptr, 0, &zero_time)<0)
+        {   reactor_unreg(fd);
             throw ReactorError(ReactorError::Reason::REG);
-
-        //Add socket to lookup table
-        kqueue_data->table[fd] = new Socket(*this);
+        }
     }
 
     //Handle reactor event
@@ -38,9 +52,17 @@ namespace libasync
         {   std::string read_data;
             ssize_t count;
             bool closed = false;
+            //Peer half-closed connection; no more data arrives after what is buffered
+            bool peer_closed = event->flags&EV_EOF;
+            size_t budget = reactor::wait_state.policy.read_budget;
 
             while (true)
-            {   count = read(data->fd, sock_buffer, SOCK_BUFFER_SIZE);
+            {   //Read budget exhausted; read filter is level-triggered, so remaining data is reported again
+                if (budget&&(read_data.size()>=budget))
+                    break;
+
+                reactor::count_syscall();
+                count = read(data->fd, sock_buffer, SOCK_BUFFER_SIZE);
 
                 if (count==-1)
                 {   //Read error
@@ -57,6 +79,11 @@ namespace libasync
 
                 //Append to buffer
                 read_data.append(sock_buffer, count);
+                //Short read after peer half-closed; treat as EOF without another read
+                if (peer_closed&&(size_t(count)<SOCK_BUFFER_SIZE))
+                {   closed = true;
+                    break;
+                }
             }
 
             //Data received
@@ -71,6 +98,7 @@ namespace libasync
                 if (data->status==Status::HALF_CLOSED)
                 {   //Set status and trigger "close" event
                     data->status = Status::CLOSED;
+                    data->load_token.reset();
                     this->trigger("close");
                     //Unregister server socket from reactor
                     reactor_unreg(data->fd);
@@ -90,6 +118,7 @@ namespace libasync
                 socklen_t result_len = sizeof(result);
 
                 //Check connection error
+                reactor::count_syscall();
                 if (getsockopt(data->fd, SOL_SOCKET, SO_ERROR, &result, &result_len)<0)
                 {   this->trigger("error", SocketError(SocketError::Reason::CONNECT));
                     //Close socket and return
@@ -103,50 +132,83 @@ namespace libasync
                     return;
                 }
 
-                //Connected; trigger "connect" event
+                //Connected; flush data written while connecting and trigger "connect" event
+                //(Disables write filter unless data is still pending)
                 data->status = Status::CONNECTED;
+                this->reactor_write();
+                this->resolve_writes();
                 this->trigger("connect");
             }
             //Write
             else
-            {   std::string& buffer = data->buffer;
-                size_t offset = 0;
-
-                while (true)
-                {   //Check buffer emptiness and fetch data for sending
-                    if (offset>=buffer.size())
-                        break;
-                    size_t write_len = std::min<size_t>(buffer.size()-offset, SOCK_BUFFER_SIZE);
-
-                    //Try writing to socket
-                    ssize_t count = ::write(data->fd, buffer.c_str()+offset, write_len);
-                    if (count==-1)
-                    {   if ((errno!=EAGAIN)&&(errno!=EWOULDBLOCK))
-                            throw SocketError(SocketError::Reason::WRITE);
-                        else
-                            break;
-                    }
-                    //Update offset
-                    offset += count;
-                }
-
-                //Update write buffer and bytes written count
-                buffer = buffer.substr(offset);
-                data->bytes_written += offset;
+            {   this->reactor_write();
                 //Resolve write promises
-                while (data->write_promise_queue.size()>0)
-                {   auto promise_item = data->write_promise_queue.front();
-                    //Target not reached
-                    if (promise_item.target>data->bytes_written)
-                        break;
-
-                    //Resolve write promise
-                    promise_item.ctx.resolve();
-                    //Pop item from queue
-                    data->write_promise_queue.pop();
-                }
+                this->resolve_writes();
+            }
+        }
+    }
+
+    //Connect to remote address
+    bool Socket::reactor_connect(const sockaddr_in& addr_obj)
+    {   auto data = this->data;
+
+        //Try to connect to remote
+        reactor::count_syscall();
+        if (::connect(data->fd, (sockaddr*)(&addr_obj), sizeof(sockaddr_in))<0)
+        {   //Still in process; enable write filter for completion
+            if (errno==EINPROGRESS)
+            {   data->write_interest = true;
+                watch_write(data->fd, data->reg_data, true);
+                return false;
+            }
+            //Error connecting
+            else
+                throw SocketError(SocketError::Reason::CONNECT);
+        }
+
+        return true;
+    }
+
+    //Write buffered data to socket
+    bool Socket::reactor_write()
+    {   auto data = this->data;
+        std::string& buffer = data->buffer;
+        size_t offset = 0;
+
+        //Keep writing until finished or blocked
+        while (offset<buffer.size())
+        {   //Try writing to socket
+            reactor::count_syscall();
+            ssize_t count = ::write(data->fd, buffer.c_str()+offset, buffer.size()-offset);
+            if (count==-1)
+            {   if ((errno!=EAGAIN)&&(errno!=EWOULDBLOCK))
+                    throw SocketError(SocketError::Reason::WRITE);
+                else
+                    break;
             }
+            //Update offset
+            offset += count;
+        }
+
+        //Update write buffer and bytes written count
+        buffer.erase(0, offset);
+        data->bytes_written += offset;
+
+        //Enable write filter only while data is pending
+        bool pending = !buffer.empty();
+        if ((data->status!=Status::CONNECTING)&&(data->fd>=0)&&(data->write_interest!=pending))
+        {   data->write_interest = pending;
+            watch_write(data->fd, data->reg_data, pending);
         }
+
+        return !pending;
+    }
+
+    //Close socket file descriptor
+    void Socket::reactor_close()
+    {   reactor::count_syscall();
+        if (::close(this->data->fd)<0)
+            throw SocketError(SocketError::Reason::CLOSE);
     }
 
     //Register server socket to reactor
@@ -154,14 +216,16 @@ namespace libasync
     {   struct kevent new_event;
         int fd = this->data->fd;
 
+        //Add server socket to lookup table
+        void* udata = kqueue_table_add(fd, this->data->reactor_slot.attach(this->data));
         //Set kevent object
-        EV_SET(&new_event, fd, EVFILT_READ, EV_ADD|EV_ENABLE, 0, 0, 0);
+        EV_SET(&new_event, fd, EVFILT_READ, EV_ADD|EV_ENABLE, 0, 0, udata);
         //Add to kqueue file descriptor
+        reactor::count_syscall();
         if (kevent(kqueue_data->fd, &new_event, 1, nullptr, 0, &zero_time)<0)
+        {   reactor_unreg(fd);
             throw ReactorError(ReactorError::Reason::REG);
-
-        //Add server socket to lookup table
-        kqueue_data->table[fd] = new ServerSocket(*this);
+        }
     }
 
     //Handle reactor event
@@ -172,6 +236,7 @@ namespace libasync
         {   sockaddr_in client_addr;
             socklen_t client_addr_len = sizeof(sockaddr_in);
 
+            reactor::count_syscall();
             int client_fd = accept(data->fd, (sockaddr*)(&client_addr), &client_addr_len);
             if (client_fd==-1)
             {   //No more incoming connections
@@ -183,15 +248,7 @@ namespace libasync
             }
 
             //Create socket for incoming connection
-            Socket client_sock(client_fd);
-            auto client_data = client_sock.data;
-            //Set client local and remote address information
-            client_data->local_addr = data->local_addr;
-            client_data->local_port = data->local_port;
-            client_data->remote_addr = client_addr.sin_addr.s_addr;
-            client_data->remote_port = client_addr.sin_port;
-            //Trigger "connect" event
-            this->trigger("connect", client_sock);
+            this->accepted(client_fd, client_addr);
         }
     }
 }
@@ -0,0 +1,67 @@
+#include <sys/event.h>
+#include <libasync/watcher.h>
+#include <libasync/reactor.h>
+#include <libasync/FreeBSD/reactor.h>
+
+namespace libasync
+{   //Apply watched events to kqueue
+    static int watcher_apply(int fd, bool readable, bool writable, FdWatcher::Mode mode, void* udata)
+    {   struct kevent new_events[2];
+        unsigned short clear_flag = (mode==FdWatcher::Mode::EDGE)?EV_CLEAR:0;
+
+        //(Adding an existing filter modifies it)
+        EV_SET(new_events, fd, EVFILT_READ, EV_ADD|clear_flag|(readable?EV_ENABLE:EV_DISABLE), 0, 0, udata);
+        EV_SET(new_events+1, fd, EVFILT_WRITE, EV_ADD|clear_flag|(writable?EV_ENABLE:EV_DISABLE), 0, 0, udata);
+        reactor::count_syscall();
+        return kevent(kqueue_data->fd, new_events, 2, nullptr, 0, &zero_time);
+    }
+
+    //Register watcher to reactor
+    void FdWatcher::reactor_register()
+    {   auto data = this->data;
+
+        //Add watcher to lookup table
+        void* udata = kqueue_table_add(data->fd, data->reactor_slot.attach(data));
+        data->reg_data = uintptr_t(udata);
+        //Add to kqueue descriptor
+        if (watcher_apply(data->fd, data->readable, data->writable, data->mode, udata)<0)
+        {   reactor_unreg(data->fd);
+            throw ReactorError(ReactorError::Reason::REG);
+        }
+    }
+
+    //Update watched events in reactor
+    void FdWatcher::reactor_update()
+    {   auto data = this->data;
+
+        if (watcher_apply(data->fd, data->readable, data->writable, data->mode, reinterpret_cast<void*>(uintptr_t(data->reg_data)))<0)
+            throw ReactorError(ReactorError::Reason::MODIFY);
+    }
+
+    //Unregister watcher from reactor
+    void FdWatcher::reactor_stop()
+    {   int fd = this->data->fd;
+        struct kevent new_events[2];
+
+        //(File descriptor may already be closed by owner)
+        EV_SET(new_events, fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+        EV_SET(new_events+1, fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+        reactor::count_syscall();
+        kevent(kqueue_data->fd, new_events, 2, nullptr, 0, &zero_time);
+        reactor_unreg(fd);
+    }
+
+    //Handle reactor event
+    void FdWatcher::reactor_on_event(void* _event)
+    {   auto event = (struct kevent*)_event;
+        auto data = this->data;
+
+        //Trigger events (Watcher may be stopped by handlers)
+        if ((event->filter==EVFILT_READ)&&data->readable)
+            this->trigger("readable");
+        else if ((event->filter==EVFILT_WRITE)&&data->writable)
+            this->trigger("writable");
+        if ((event->flags&EV_EOF)&&data->active)
+            this->trigger("hangup");
+    }
+}
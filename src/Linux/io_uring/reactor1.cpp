@@ -0,0 +1,311 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <libasync/reactor.h>
+#include <libasync/taskloop.h>
+#include <libasync/Linux/io_uring/reactor.h>
+
+namespace libasync
+{   //io_uring data
+    thread_local UringData* uring_data = nullptr;
+
+    //io_uring system call wrappers
+    static int uring_setup(unsigned entries, io_uring_params* params)
+    {   return syscall(__NR_io_uring_setup, entries, params);
+    }
+
+    static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg = nullptr, size_t arg_size = 0)
+    {   return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size);
+    }
+
+    static int uring_register(int fd, unsigned opcode, void* arg, unsigned n_args)
+    {   return syscall(__NR_io_uring_register, fd, opcode, arg, n_args);
+    }
+
+    //Get buffer ring tail
+    //(Ring tail overlays the reserved field of first ring entry)
+    static uint16_t* uring_buf_tail()
+    {   return &uring_data->buf_ring[0].resv;
+    }
+
+    //Add provided buffer back to buffer ring
+    static void uring_provide(uint16_t bid, uint16_t offset)
+    {   auto buf = uring_data->buf_ring+((*uring_buf_tail()+offset)&(URING_N_BUFFERS-1));
+
+        buf->addr = reinterpret_cast<uint64_t>(uring_data->buffers+bid*URING_BUFFER_SIZE);
+        buf->len = URING_BUFFER_SIZE;
+        buf->bid = bid;
+    }
+
+    //Wake up reactor blocked in another thread
+    static void uring_wakeup(void* arg)
+    {   uint64_t value = 1;
+        write(int(intptr_t(arg)), &value, sizeof(uint64_t));
+    }
+
+    //Submit read operation on wakeup event descriptor
+    static void uring_wakeup_read()
+    {   auto sqe = uring_prep(uring_data->wakeup_fd, 0);
+
+        sqe->opcode = IORING_OP_READ;
+        sqe->addr = reinterpret_cast<uint64_t>(&uring_data->wakeup_value);
+        sqe->len = sizeof(uint64_t);
+        sqe->user_data = URING_OP_WAKEUP;
+    }
+
+    //Get a submission queue entry for an operation on given file descriptor
+    io_uring_sqe* uring_prep(int fd, uint64_t op)
+    {   unsigned tail = *uring_data->sq_tail;
+
+        //Submission queue full; submit queued entries first
+        if (tail-__atomic_load_n(uring_data->sq_head, __ATOMIC_ACQUIRE)>=uring_data->sq_entries)
+        {   uring_submit();
+            if (tail-__atomic_load_n(uring_data->sq_head, __ATOMIC_ACQUIRE)>=uring_data->sq_entries)
+                throw ReactorError(ReactorError::Reason::REG, EBUSY);
+        }
+
+        //Fill submission queue entry
+        unsigned index = tail&uring_data->sq_mask;
+        auto sqe = uring_data->sqes+index;
+        memset(sqe, 0, sizeof(io_uring_sqe));
+        sqe->fd = fd;
+
+        //Tag entry with reactor target and operation type
+        //(Operations without a target complete silently)
+        auto& table = uring_data->table;
+        if ((op!=0)&&(fd>=0)&&(size_t(fd)<table.size())&&table[fd])
+        {   auto target = table[fd];
+            sqe->user_data = reinterpret_cast<uint64_t>(target)|op;
+            target->reactor_n_ops++;
+        }
+
+        //Publish entry
+        uring_data->sq_array[index] = index;
+        __atomic_store_n(uring_data->sq_tail, tail+1, __ATOMIC_RELEASE);
+        uring_data->n_unsubmitted++;
+
+        return sqe;
+    }
+
+    //Submit queued entries to kernel
+    void uring_submit()
+    {   while (uring_data->n_unsubmitted>0)
+        {   reactor::count_syscall();
+            int n_submitted = uring_enter(uring_data->fd, uring_data->n_unsubmitted, 0, 0);
+            if (n_submitted==-1)
+            {   //Interrupted; try again
+                if (errno==EINTR)
+                    continue;
+                //Completion queue busy; retry during next reactor task
+                else if ((errno==EAGAIN)||(errno==EBUSY))
+                    break;
+                else
+                    throw ReactorError(ReactorError::Reason::REG);
+            }
+            uring_data->n_unsubmitted -= n_submitted;
+        }
+    }
+
+    //Get provided buffer by buffer ID
+    char* uring_buffer(uint16_t bid)
+    {   return uring_data->buffers+bid*URING_BUFFER_SIZE;
+    }
+
+    //Reactor task
+    void reactor_task()
+    {   unsigned flags = IORING_ENTER_GETEVENTS;
+        //Wait until next timer event
+        int timeout = reactor::wait_timeout();
+        __kernel_timespec timeout_obj;
+        io_uring_getevents_arg arg;
+        if (timeout>=0)
+        {   timeout_obj.tv_sec = timeout/1000;
+            timeout_obj.tv_nsec = (timeout%1000)*1000000;
+            memset(&arg, 0, sizeof(io_uring_getevents_arg));
+            arg.ts = reinterpret_cast<uint64_t>(&timeout_obj);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+
+        //Submit queued operations and wait for completions in one system call
+        int result = (timeout>=0)
+            ?uring_enter(uring_data->fd, uring_data->n_unsubmitted, 1, flags, &arg, sizeof(io_uring_getevents_arg))
+            :uring_enter(uring_data->fd, uring_data->n_unsubmitted, 1, flags);
+        unsigned head = *uring_data->cq_head;
+        reactor::wait_done(__atomic_load_n(uring_data->cq_tail, __ATOMIC_ACQUIRE)-head);
+        if (result>=0)
+            uring_data->n_unsubmitted -= result;
+        //(Timed out, interrupted or busy)
+        else if ((errno!=ETIME)&&(errno!=EINTR)&&(errno!=EAGAIN)&&(errno!=EBUSY))
+        {   ::close(uring_data->fd);
+            throw ReactorError(ReactorError::Reason::QUERY);
+        }
+
+        //Demultiplex completions
+        //(At most one batch; remaining completions are handled next round without waiting)
+        for (size_t i=0;(i<reactor::wait_state.batch_size)&&(head!=__atomic_load_n(uring_data->cq_tail, __ATOMIC_ACQUIRE));i++)
+        {   //Copy completion entry and release its slot
+            io_uring_cqe cqe = uring_data->cqes[head&uring_data->cq_mask];
+            head++;
+            __atomic_store_n(uring_data->cq_head, head, __ATOMIC_RELEASE);
+
+            //Lookup for reactor target
+            //(Operations without a target are ignored)
+            auto target = reinterpret_cast<ReactorTarget*>(cqe.user_data&~URING_OP_MASK);
+            if (!target)
+            {   //Woken up by posting thread; wait for next wakeup
+                if (cqe.user_data==URING_OP_WAKEUP)
+                    uring_wakeup_read();
+                continue;
+            }
+
+            //Call event handler (Unless unregistered)
+            if (!target->reactor_unregistered)
+                reactor::dispatch(target, &cqe);
+
+            //Return provided buffer to buffer ring
+            if (cqe.flags&IORING_CQE_F_BUFFER)
+            {   uring_provide(cqe.flags>>IORING_CQE_BUFFER_SHIFT, 0);
+                __atomic_store_n(uring_buf_tail(), *uring_buf_tail()+1, __ATOMIC_RELEASE);
+            }
+            //Operation finished (Multi-shot operations may continue)
+            if (!(cqe.flags&IORING_CQE_F_MORE))
+            {   target->reactor_n_ops--;
+
+                //Release unregistered target after its last operation
+                if ((target->reactor_n_ops==0)&&target->reactor_unregistered)
+                    reactor::release(target);
+            }
+        }
+    }
+
+    //Reactor module initialization
+    void reactor_init()
+    {   //Initialize io_uring data
+        auto data = uring_data = new UringData();
+        data->n_unsubmitted = 0;
+
+        //Create io_uring instance
+        io_uring_params params;
+        memset(&params, 0, sizeof(io_uring_params));
+        int fd = uring_setup(URING_QUEUE_SIZE, &params);
+        if (fd==-1)
+            throw ReactorError(ReactorError::Reason::INIT);
+        data->fd = fd;
+        //Waiting with timeout is required
+        if (!(params.features&IORING_FEAT_EXT_ARG))
+            throw ReactorError(ReactorError::Reason::INIT, ENOSYS);
+
+        //Map submission and completion queue rings
+        data->sq_ring_size = params.sq_off.array+params.sq_entries*sizeof(unsigned);
+        data->cq_ring_size = params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+        //(Both rings share one mapping)
+        if (params.features&IORING_FEAT_SINGLE_MMAP)
+        {   if (data->cq_ring_size>data->sq_ring_size)
+                data->sq_ring_size = data->cq_ring_size;
+            data->cq_ring_size = data->sq_ring_size;
+        }
+        data->sq_ring = mmap(nullptr, data->sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (data->sq_ring==MAP_FAILED)
+            throw ReactorError(ReactorError::Reason::INIT);
+        if (params.features&IORING_FEAT_SINGLE_MMAP)
+            data->cq_ring = data->sq_ring;
+        else
+        {   data->cq_ring = mmap(nullptr, data->cq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (data->cq_ring==MAP_FAILED)
+                throw ReactorError(ReactorError::Reason::INIT);
+        }
+        //Map submission queue entries
+        void* sqes = mmap(nullptr, params.sq_entries*sizeof(io_uring_sqe), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes==MAP_FAILED)
+            throw ReactorError(ReactorError::Reason::INIT);
+        data->sqes = (io_uring_sqe*)sqes;
+
+        //Submission queue ring fields
+        auto sq_ring = (char*)data->sq_ring;
+        data->sq_head = (unsigned*)(sq_ring+params.sq_off.head);
+        data->sq_tail = (unsigned*)(sq_ring+params.sq_off.tail);
+        data->sq_mask = *(unsigned*)(sq_ring+params.sq_off.ring_mask);
+        data->sq_entries = *(unsigned*)(sq_ring+params.sq_off.ring_entries);
+        data->sq_array = (unsigned*)(sq_ring+params.sq_off.array);
+        //Completion queue ring fields
+        auto cq_ring = (char*)data->cq_ring;
+        data->cq_head = (unsigned*)(cq_ring+params.cq_off.head);
+        data->cq_tail = (unsigned*)(cq_ring+params.cq_off.tail);
+        data->cq_mask = *(unsigned*)(cq_ring+params.cq_off.ring_mask);
+        data->cqes = (io_uring_cqe*)(cq_ring+params.cq_off.cqes);
+
+        //Allocate and register provided buffer ring
+        void* buf_ring = mmap(nullptr, URING_N_BUFFERS*sizeof(io_uring_buf), PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (buf_ring==MAP_FAILED)
+            throw ReactorError(ReactorError::Reason::INIT);
+        data->buf_ring = (io_uring_buf*)buf_ring;
+        data->buffers = new char[URING_N_BUFFERS*URING_BUFFER_SIZE];
+
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(io_uring_buf_reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+        reg.ring_entries = URING_N_BUFFERS;
+        reg.bgid = URING_BUFFER_GROUP;
+        if (uring_register(fd, IORING_REGISTER_PBUF_RING, &reg, 1)<0)
+            throw ReactorError(ReactorError::Reason::INIT);
+        //Fill buffer ring
+        for (unsigned i=0;i<URING_N_BUFFERS;i++)
+            uring_provide(i, i);
+        __atomic_store_n(uring_buf_tail(), *uring_buf_tail()+URING_N_BUFFERS, __ATOMIC_RELEASE);
+
+        //Create wakeup event descriptor and start reading it
+        //(Blocking mode; io_uring polls it internally)
+        int wakeup_fd = eventfd(0, EFD_CLOEXEC);
+        if (wakeup_fd==-1)
+            throw ReactorError(ReactorError::Reason::INIT);
+        data->wakeup_fd = wakeup_fd;
+        uring_wakeup_read();
+        TaskLoop::thread_loop().set_waker(uring_wakeup, reinterpret_cast<void*>(intptr_t(wakeup_fd)));
+
+        //Add reactor task to task loop
+        TaskLoop::thread_loop().add(reactor_task);
+    }
+
+    //Add reactor target to lookup table
+    void uring_table_add(int fd, ReactorTarget* target)
+    {   auto& table = uring_data->table;
+
+        //Grow lookup table
+        if (size_t(fd)>=table.size())
+            table.resize(std::max<size_t>(fd+1, table.size()*2), nullptr);
+        //Release previous target (File descriptor closed and reused)
+        reactor_unreg(fd);
+
+        table[fd] = target;
+        target->reactor_unregistered = false;
+    }
+
+    //Unregister object from reactor
+    void reactor_unreg(int fd)
+    {   //Find object associated with the file descriptor
+        if ((fd<0)||(size_t(fd)>=uring_data->table.size()))
+            return;
+        auto target = uring_data->table[fd];
+        if (!target)
+            return;
+        uring_data->table[fd] = nullptr;
+
+        //Release target immediately if no operation is in flight
+        if (target->reactor_n_ops==0)
+            reactor::release(target);
+        //Otherwise cancel all operations and release target after they finish
+        //(Submitted immediately since file descriptor may be closed soon after)
+        else
+        {   target->reactor_unregistered = true;
+
+            auto sqe = uring_prep(fd, 0);
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD|IORING_ASYNC_CANCEL_ALL;
+            uring_submit();
+        }
+    }
+}
@@ -0,0 +1 @@
+../signals1.cpp
\ No newline at end of file
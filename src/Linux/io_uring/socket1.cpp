@@ -0,0 +1,221 @@
+#include <unistd.h>
+#include <sys/socket.h>
+#include <string>
+#include <libasync/socket.h>
+#include <libasync/taskloop.h>
+#include <libasync/reactor.h>
+#include <libasync/Linux/io_uring/reactor.h>
+
+namespace libasync
+{   //Submit multi-shot receive operation
+    static void uring_recv(int fd)
+    {   auto sqe = uring_prep(fd, URING_OP_READ);
+
+        sqe->opcode = IORING_OP_RECV;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUFFER_GROUP;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+    }
+
+    //Submit accept operation
+    static void uring_accept(int fd, sockaddr_in* addr, socklen_t* addr_len)
+    {   auto sqe = uring_prep(fd, URING_OP_ACCEPT);
+
+        *addr_len = sizeof(sockaddr_in);
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = reinterpret_cast<uint64_t>(addr);
+        sqe->addr2 = reinterpret_cast<uint64_t>(addr_len);
+    }
+
+    //Register socket to reactor
+    void Socket::reactor_register()
+    {   int fd = this->data->fd;
+
+        //Add socket to lookup table
+        uring_table_add(fd, this->data->reactor_slot.attach(this->data));
+        reactor::set_busy_poll(fd);
+
+        //Start receiving data for connected socket
+        if (this->data->status==Status::CONNECTED)
+            uring_recv(fd);
+    }
+
+    //Handle reactor event
+    void Socket::reactor_on_event(void* _event)
+    {   auto cqe = (io_uring_cqe*)_event;
+        auto data = this->data;
+
+        switch (cqe->user_data&URING_OP_MASK)
+        {   //Data received
+            case URING_OP_READ:
+            {   //Receive operation cancelled
+                if (cqe->res==-ECANCELED)
+                    break;
+                //Out of provided buffers; try again
+                else if (cqe->res==-ENOBUFS)
+                {   if (data->status==Status::CONNECTED)
+                        uring_recv(data->fd);
+                    break;
+                }
+                //Read error
+                else if (cqe->res<0)
+                    throw SocketError(SocketError::Reason::READ, -cqe->res);
+                //Data received
+                else if (cqe->res>0)
+                {   std::string read_data(uring_buffer(cqe->flags>>IORING_CQE_BUFFER_SHIFT), cqe->res);
+
+                    data->bytes_read += read_data.size();
+                    this->trigger("data", read_data);
+                    //Re-arm receive operation if it stopped
+                    if ((!(cqe->flags&IORING_CQE_F_MORE))&&(data->status==Status::CONNECTED))
+                        uring_recv(data->fd);
+                    break;
+                }
+
+                //EOF; peer closed connection
+                //(Half-closed)
+                if (data->status==Status::HALF_CLOSED)
+                {   //Set status and trigger "close" event
+                    data->status = Status::CLOSED;
+                    data->load_token.reset();
+                    this->trigger("close");
+                    //Unregister socket from reactor
+                    reactor_unreg(data->fd);
+                }
+                //Open
+                else
+                {   data->status = Status::HALF_CLOSED;
+                    this->trigger("end");
+                }
+                break;
+            }
+            //Data sent
+            case URING_OP_WRITE:
+            {   //Send operation cancelled
+                if (cqe->res==-ECANCELED)
+                    break;
+                //Write error
+                else if (cqe->res<0)
+                    throw SocketError(SocketError::Reason::WRITE, -cqe->res);
+
+                //Update send buffer and bytes written count
+                data->send_buffer.erase(0, cqe->res);
+                data->bytes_written += cqe->res;
+                //Send remaining data
+                if (!data->send_buffer.empty())
+                {   auto sqe = uring_prep(data->fd, URING_OP_WRITE);
+
+                    sqe->opcode = IORING_OP_SEND;
+                    sqe->addr = reinterpret_cast<uint64_t>(data->send_buffer.data());
+                    sqe->len = data->send_buffer.size();
+                    sqe->msg_flags = MSG_NOSIGNAL;
+                }
+                else
+                    this->reactor_write();
+
+                //Resolve write promises
+                this->resolve_writes();
+                break;
+            }
+            //Connect finished
+            case URING_OP_CONNECT:
+            {   //Connect operation cancelled
+                if (cqe->res==-ECANCELED)
+                    break;
+                //Error connecting
+                else if (cqe->res<0)
+                {   this->trigger("error", SocketError(SocketError::Reason::CONNECT, -cqe->res));
+                    //Close socket and return
+                    this->close();
+                    break;
+                }
+
+                //Connected; start receiving data and trigger "connect" event
+                data->status = Status::CONNECTED;
+                uring_recv(data->fd);
+                this->trigger("connect");
+                break;
+            }
+        }
+    }
+
+    //Connect to remote address
+    bool Socket::reactor_connect(const sockaddr_in& addr_obj)
+    {   auto data = this->data;
+        auto sqe = uring_prep(data->fd, URING_OP_CONNECT);
+
+        //Address object must outlive the operation
+        data->remote_addr_obj = addr_obj;
+        sqe->opcode = IORING_OP_CONNECT;
+        sqe->addr = reinterpret_cast<uint64_t>(&data->remote_addr_obj);
+        sqe->off = sizeof(sockaddr_in);
+
+        return false;
+    }
+
+    //Write buffered data to socket
+    bool Socket::reactor_write()
+    {   auto data = this->data;
+
+        //Send operation in flight; buffered data will be sent after it finishes
+        if (!data->send_buffer.empty())
+            return false;
+        //Nothing to send
+        if (data->buffer.empty())
+            return true;
+
+        //Move buffered data to send buffer and submit send operation
+        data->send_buffer.swap(data->buffer);
+        auto sqe = uring_prep(data->fd, URING_OP_WRITE);
+
+        sqe->opcode = IORING_OP_SEND;
+        sqe->addr = reinterpret_cast<uint64_t>(data->send_buffer.data());
+        sqe->len = data->send_buffer.size();
+        sqe->msg_flags = MSG_NOSIGNAL;
+
+        return false;
+    }
+
+    //Close socket file descriptor
+    void Socket::reactor_close()
+    {   int fd = this->data->fd;
+
+        //Cancel operations in flight before closing
+        reactor_unreg(fd);
+        if (::close(fd)<0)
+            throw SocketError(SocketError::Reason::CLOSE);
+    }
+
+    //Register server socket to reactor
+    void ServerSocket::reactor_register()
+    {   auto data = this->data;
+
+        //Add server socket to lookup table
+        uring_table_add(data->fd, data->reactor_slot.attach(data));
+
+        //Start accepting connections
+        uring_accept(data->fd, &data->accept_addr, &data->accept_addr_len);
+    }
+
+    //Handle reactor event
+    void ServerSocket::reactor_on_event(void* _event)
+    {   auto cqe = (io_uring_cqe*)_event;
+        auto data = this->data;
+        int client_fd = cqe->res;
+
+        //Accept operation cancelled
+        if (client_fd==-ECANCELED)
+            return;
+        //Error accepting incoming connection
+        if ((client_fd<0)&&(client_fd!=-EAGAIN)&&(client_fd!=-EINTR))
+            throw SocketError(SocketError::Reason::ACCEPT, -client_fd);
+
+        //Create socket for incoming connection
+        if (client_fd>=0)
+            this->accepted(client_fd, data->accept_addr);
+
+        //Accept next connection
+        if (data->status==Status::LISTENING)
+            uring_accept(data->fd, &data->accept_addr, &data->accept_addr_len);
+    }
+}
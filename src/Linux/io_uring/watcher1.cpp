@@ -0,0 +1,104 @@
+#include <poll.h>
+#include <libasync/watcher.h>
+#include <libasync/reactor.h>
+#include <libasync/Linux/io_uring/reactor.h>
+
+namespace libasync
+{   //Get poll events for watcher
+    static uint32_t watcher_events(bool readable, bool writable)
+    {   uint32_t events = 0;
+
+        if (readable)
+            events |= POLLIN|POLLRDHUP;
+        if (writable)
+            events |= POLLOUT;
+        return events;
+    }
+
+    //Submit poll operation for watcher
+    //(Edge mode uses a multi-shot poll; level mode re-arms a oneshot poll after each event)
+    static void watcher_poll(int fd, uint32_t events, FdWatcher::Mode mode)
+    {   auto sqe = uring_prep(fd, URING_OP_POLL);
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = events;
+        if (mode==FdWatcher::Mode::EDGE)
+            sqe->len = IORING_POLL_ADD_MULTI;
+    }
+
+    //Register watcher to reactor
+    void FdWatcher::reactor_register()
+    {   auto data = this->data;
+        uint32_t events = watcher_events(data->readable, data->writable);
+
+        //Add watcher to lookup table
+        uring_table_add(data->fd, data->reactor_slot.attach(data));
+        //Start polling (Registration data holds poll operation state)
+        data->reg_data = events!=0;
+        if (events)
+            watcher_poll(data->fd, events, data->mode);
+    }
+
+    //Update watched events in reactor
+    void FdWatcher::reactor_update()
+    {   auto data = this->data;
+        uint32_t events = watcher_events(data->readable, data->writable);
+
+        //Not polling; start polling
+        if (!data->reg_data)
+        {   data->reg_data = events!=0;
+            if (events)
+                watcher_poll(data->fd, events, data->mode);
+            return;
+        }
+
+        //Update or remove poll operation in flight
+        //(Matched by its user data; completion of this operation is ignored)
+        auto target = uring_data->table[data->fd];
+        auto sqe = uring_prep(data->fd, 0);
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = reinterpret_cast<uint64_t>(target)|URING_OP_POLL;
+        if (events)
+        {   sqe->len = IORING_POLL_UPDATE_EVENTS;
+            sqe->poll32_events = events;
+        }
+        else
+            data->reg_data = 0;
+    }
+
+    //Unregister watcher from reactor
+    void FdWatcher::reactor_stop()
+    {   //(Operations in flight are cancelled)
+        reactor_unreg(this->data->fd);
+    }
+
+    //Handle reactor event
+    void FdWatcher::reactor_on_event(void* _event)
+    {   auto cqe = (io_uring_cqe*)_event;
+        auto data = this->data;
+
+        //Poll operation removed
+        if (cqe->res==-ECANCELED)
+            return;
+        //Poll error
+        else if (cqe->res<0)
+            throw ReactorError(ReactorError::Reason::QUERY, -cqe->res);
+
+        //Trigger events (Watcher may be stopped by handlers)
+        if ((cqe->res&POLLIN)&&data->readable)
+            this->trigger("readable");
+        if ((cqe->res&POLLOUT)&&data->writable&&data->active)
+            this->trigger("writable");
+        if ((cqe->res&(POLLHUP|POLLRDHUP|POLLERR))&&data->active)
+            this->trigger("hangup");
+
+        //Poll operation finished; re-arm it
+        if (!(cqe->flags&IORING_CQE_F_MORE)&&data->active&&data->reg_data)
+        {   uint32_t events = watcher_events(data->readable, data->writable);
+
+            data->reg_data = events!=0;
+            if (events)
+                watcher_poll(data->fd, events, data->mode);
+        }
+    }
+}
@@ -1,5 +1,9 @@
+#include <errno.h>
 #include <unistd.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <algorithm>
+#include <vector>
 #include <libasync/reactor.h>
 #include <libasync/taskloop.h>
 #include <libasync/Linux/reactor.h>
@@ -8,25 +12,83 @@ namespace libasync
 {   //Epoll data
     thread_local EpollData* epoll_data = nullptr;
 
+    //Wake up reactor blocked in another thread
+    static void epoll_wakeup(void* arg)
+    {   uint64_t value = 1;
+        write(int(intptr_t(arg)), &value, sizeof(uint64_t));
+    }
+
+    //Dispatch event to reactor target
+    static void epoll_dispatch(epoll_event* event_ptr)
+    {   //Lookup for reactor target
+        //(Event data holds file descriptor in lower and generation in upper 32 bits)
+        uint32_t fd = event_ptr->data.u64;
+        uint32_t generation = event_ptr->data.u64>>32;
+        //(Ignore stale events of unregistered targets)
+        if (fd>=epoll_data->table.size())
+            return;
+        auto& entry = epoll_data->table[fd];
+        if ((!entry.target)||(entry.generation!=generation))
+            return;
+
+        //Call event handler
+        reactor::dispatch(entry.target, event_ptr);
+    }
+
     //Reactor task
     void reactor_task()
-    {   //Wait for epoll events
-        int n_events = epoll_wait(epoll_data->fd, epoll_data->events, EPOLL_EVENT_BUFFER_SIZE, -1);
-        if (n_events==-1)
+    {   auto& events = epoll_data->events;
+        //Resize events buffer to current batch size
+        if (events.size()!=reactor::wait_state.batch_size)
+            events.resize(reactor::wait_state.batch_size);
+
+        //Wait for epoll events until next timer event
+        //(Do not block if targets are waiting to be served again)
+        int n_events = epoll_wait(epoll_data->fd, events.data(), events.size(), reactor::wait_timeout(!epoll_data->ready.empty()));
+        reactor::wait_done(std::max(n_events, 0));
+        //Interrupted by signal
+        if ((n_events==-1)&&(errno==EINTR))
+            return;
+        else if (n_events==-1)
         {   ::close(epoll_data->fd);
             throw ReactorError(ReactorError::Reason::QUERY);
         }
 
+        //Targets requeued in previous round (Served after new events; they may requeue again)
+        auto& ready = epoll_data->ready_current;
+        ready.swap(epoll_data->ready);
+
         //Demultiplex events
         for (int i=0;i<n_events;i++)
         {   //Event object pointer
-            auto event_ptr = epoll_data->events+i;
-            //Lookup for reactor target
-            auto target = epoll_data->table[event_ptr->data.fd];
+            auto event_ptr = &events[i];
+            //Woken up by posting thread; reset wakeup event descriptor
+            if (event_ptr->data.u64==EPOLL_WAKEUP_DATA)
+            {   uint64_t value;
+                reactor::count_syscall();
+                read(epoll_data->wakeup_fd, &value, sizeof(uint64_t));
+                continue;
+            }
+            epoll_dispatch(event_ptr);
+        }
+        //Serve requeued targets again (Only reading is resumed)
+        for (size_t i=0;i<ready.size();i++)
+        {   uint32_t fd = ready[i];
+            auto& entry = epoll_data->table[fd];
+            if (entry.generation==uint32_t(ready[i]>>32))
+                entry.requeued = false;
 
-            //Call event handler
-            target->reactor_on_event(event_ptr);
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.u64 = ready[i];
+            epoll_dispatch(&event);
         }
+        ready.clear();
+
+        //Release unregistered targets
+        for (auto target : epoll_data->garbage)
+            reactor::release(target);
+        epoll_data->garbage.clear();
     }
 
     //Reactor module initialization
@@ -39,19 +101,67 @@ namespace libasync
         if (fd==-1)
             throw ReactorError(ReactorError::Reason::INIT);
         epoll_data->fd = fd;
+        epoll_data->generation = 0;
+
+        //Create wakeup event descriptor and add it to epoll file descriptor
+        int wakeup_fd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+        if (wakeup_fd==-1)
+            throw ReactorError(ReactorError::Reason::INIT);
+        epoll_data->wakeup_fd = wakeup_fd;
+
+        epoll_event wakeup_event;
+        wakeup_event.data.u64 = EPOLL_WAKEUP_DATA;
+        wakeup_event.events = EPOLLIN;
+        if (epoll_ctl(fd, EPOLL_CTL_ADD, wakeup_fd, &wakeup_event)<0)
+            throw ReactorError(ReactorError::Reason::INIT);
+        TaskLoop::thread_loop().set_waker(epoll_wakeup, reinterpret_cast<void*>(intptr_t(wakeup_fd)));
 
         //Add reactor task to task loop
         TaskLoop::thread_loop().add(reactor_task);
     }
 
+    //Add reactor target to lookup table
+    uint64_t epoll_table_add(int fd, ReactorTarget* target)
+    {   auto& table = epoll_data->table;
+
+        //Grow lookup table
+        if (size_t(fd)>=table.size())
+            table.resize(std::max<size_t>(fd+1, table.size()*2), EpollEntry{nullptr, 0, false});
+        //Release previous target (File descriptor closed and reused)
+        auto& entry = table[fd];
+        if (entry.target)
+            epoll_data->garbage.push_back(entry.target);
+
+        //Set target and registration generation
+        entry.target = target;
+        entry.generation = ++epoll_data->generation;
+        entry.requeued = false;
+
+        return (uint64_t(entry.generation)<<32)|uint32_t(fd);
+    }
+
+    //Serve target again in next round
+    void epoll_requeue(uint64_t event_data)
+    {   auto& entry = epoll_data->table[uint32_t(event_data)];
+        //(Queued at most once; a target served by a new event may still be queued)
+        if (entry.requeued)
+            return;
+
+        entry.requeued = true;
+        epoll_data->ready.push_back(event_data);
+    }
+
     //Unregister object from reactor
     void reactor_unreg(int fd)
     {   //Find object associated with the file descriptor
-        auto table_pair_ptr = epoll_data->table.find(fd);
-        if (table_pair_ptr==epoll_data->table.end())
+        if ((fd<0)||(size_t(fd)>=epoll_data->table.size()))
+            return;
+        auto& entry = epoll_data->table[fd];
+        if (!entry.target)
             return;
 
-        delete table_pair_ptr->second;
-        epoll_data->table.erase(table_pair_ptr);
+        //(Target may be handling an event; release it later)
+        epoll_data->garbage.push_back(entry.target);
+        entry.target = nullptr;
     }
 }
@@ -0,0 +1,92 @@
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <libasync/signals.h>
+#include <libasync/reactor.h>
+#include <libasync/watcher.h>
+
+namespace libasync
+{   namespace signals
+    {   //Signal file descriptor data type
+        struct SignalFdData
+        {   //Signal file descriptor
+            int fd;
+            //Handled signals
+            sigset_t mask;
+            //Watcher of signal file descriptor
+            FdWatcher* watcher;
+        };
+
+        //Signal file descriptor data of current thread
+        static thread_local SignalFdData* signal_fd_data = nullptr;
+
+        //Read pending signals and call handlers
+        static void signal_fd_read()
+        {   signalfd_siginfo info;
+
+            while (true)
+            {   reactor::count_syscall();
+                if (read(signal_fd_data->fd, &info, sizeof(signalfd_siginfo))!=sizeof(signalfd_siginfo))
+                    break;
+                dispatch(info.ssi_signo);
+            }
+        }
+
+        //Start receiving signal through reactor
+        void signal_watch(int signum)
+        {   //Create signal file descriptor and watch it
+            if (!signal_fd_data)
+            {   auto data = new SignalFdData();
+                sigemptyset(&data->mask);
+                data->fd = signalfd(-1, &data->mask, SFD_NONBLOCK|SFD_CLOEXEC);
+                if (data->fd==-1)
+                {   delete data;
+                    throw ReactorError(ReactorError::Reason::REG);
+                }
+
+                data->watcher = new FdWatcher(data->fd);
+                data->watcher->on("readable", []()
+                {   signal_fd_read();
+                });
+                signal_fd_data = data;
+            }
+            auto data = signal_fd_data;
+
+            //Block signal and add it to signal file descriptor
+            sigaddset(&data->mask, signum);
+            if (signalfd(data->fd, &data->mask, 0)==-1)
+            {   sigdelset(&data->mask, signum);
+                throw ReactorError(ReactorError::Reason::REG);
+            }
+            //(Only blocks in current thread; library threads block asynchronous signals from the start, and other
+            // threads must block the signal themselves, see "on_signal()")
+            sigset_t block_mask;
+            sigemptyset(&block_mask);
+            sigaddset(&block_mask, signum);
+            pthread_sigmask(SIG_BLOCK, &block_mask, nullptr);
+        }
+
+        //Stop receiving signal through reactor
+        void signal_unwatch(int signum)
+        {   auto data = signal_fd_data;
+            if (!data)
+                return;
+
+            //Remove signal from signal file descriptor
+            sigdelset(&data->mask, signum);
+            signalfd(data->fd, &data->mask, 0);
+
+            //Discard pending deliveries received while handled, then unblock signal
+            //(Only unblocks in current thread; library threads keep it blocked, so later deliveries reach the
+            // disposition through this or other unblocking threads)
+            sigset_t unblock_mask;
+            sigemptyset(&unblock_mask);
+            sigaddset(&unblock_mask, signum);
+            timespec zero_time = {0, 0};
+            while (sigtimedwait(&unblock_mask, nullptr, &zero_time)==signum);
+            pthread_sigmask(SIG_UNBLOCK, &unblock_mask, nullptr);
+        }
+    }
+}
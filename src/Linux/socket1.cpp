@@ -2,29 +2,50 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <string>
-#include <algorithm>
 #include <libasync/socket.h>
 #include <libasync/taskloop.h>
 #include <libasync/reactor.h>
 #include <libasync/Linux/reactor.h>
 
 namespace libasync
-{   //Socket buffer
-    char sock_buffer[SOCK_BUFFER_SIZE];
+{   //Socket buffer (One per reactor thread)
+    static thread_local char sock_buffer[SOCK_BUFFER_SIZE];
+
+    //Get epoll events for socket
+    static uint32_t socket_events(bool write_interest)
+    {   return uint32_t(EPOLLIN|EPOLLRDHUP|EPOLLET)|(write_interest?uint32_t(EPOLLOUT):0u);
+    }
+
+    //Arm or disarm write readiness events
+    //(Arming re-evaluates readiness, so an already writable socket is reported at once)
+    static void watch_write(int fd, uint64_t reg_data, bool enabled)
+    {   epoll_event new_event;
+
+        new_event.data.u64 = reg_data;
+        new_event.events = socket_events(enabled);
+        reactor::count_syscall();
+        if (epoll_ctl(epoll_data->fd, EPOLL_CTL_MOD, fd, &new_event)<0)
+            throw ReactorError(ReactorError::Reason::MODIFY);
+    }
 
     //Register socket to reactor
     void Socket::reactor_register()
-    {   epoll_event new_event;
-        int fd = this->data->fd;
+    {   auto data = this->data;
+        epoll_event new_event;
+        int fd = data->fd;
 
-        new_event.data.fd = fd;
-        new_event.events = EPOLLIN|EPOLLOUT|EPOLLET;
+        //Add socket to lookup table
+        //(Write readiness is watched only while connecting or data is pending)
+        data->reg_data = epoll_table_add(fd, data->reactor_slot.attach(data));
+        new_event.data.u64 = data->reg_data;
+        new_event.events = socket_events(false);
         //Add to epoll file descriptor
+        reactor::count_syscall();
         if (epoll_ctl(epoll_data->fd, EPOLL_CTL_ADD, fd, &new_event)<0)
+        {   reactor_unreg(fd);
             throw ReactorError(ReactorError::Reason::REG);
-
-        //Add socket to lookup table
-        epoll_data->table[fd] = new Socket(*this);
+        }
+        reactor::set_busy_poll(fd);
     }
 
     //Handle reactor event
@@ -33,13 +54,23 @@ namespace libasync
         auto data = this->data;
 
         //Read from socket; trigger data event
-        if (event->events&EPOLLIN)
+        if (event->events&(EPOLLIN|EPOLLRDHUP))
         {   std::string read_data;
             ssize_t count;
             bool closed = false;
+            //Peer half-closed connection; no more data arrives after what is buffered
+            bool peer_closed = event->events&EPOLLRDHUP;
+            size_t budget = reactor::wait_state.policy.read_budget;
 
             while (true)
-            {   count = read(data->fd, sock_buffer, SOCK_BUFFER_SIZE);
+            {   //Read budget exhausted; read remaining data in next round
+                if (budget&&(read_data.size()>=budget))
+                {   epoll_requeue(event->data.u64);
+                    break;
+                }
+
+                reactor::count_syscall();
+                count = read(data->fd, sock_buffer, SOCK_BUFFER_SIZE);
 
                 if (count==-1)
                 {   //Read error
@@ -56,6 +87,11 @@ namespace libasync
 
                 //Append to buffer
                 read_data.append(sock_buffer, count);
+                //Short read after peer half-closed; treat as EOF without another read
+                if (peer_closed&&(size_t(count)<SOCK_BUFFER_SIZE))
+                {   closed = true;
+                    break;
+                }
             }
 
             //Data received
@@ -70,6 +106,7 @@ namespace libasync
                 if (data->status==Status::HALF_CLOSED)
                 {   //Set status and trigger "close" event
                     data->status = Status::CLOSED;
+                    data->load_token.reset();
                     this->trigger("close");
                     //Unregister server socket from reactor
                     reactor_unreg(data->fd);
@@ -90,6 +127,7 @@ namespace libasync
                 socklen_t result_len = sizeof(result);
 
                 //Check connection error
+                reactor::count_syscall();
                 if (getsockopt(data->fd, SOL_SOCKET, SO_ERROR, &result, &result_len)<0)
                 {   this->trigger("error", SocketError(SocketError::Reason::CONNECT));
                     //Close socket and return
@@ -103,50 +141,83 @@ namespace libasync
                     return;
                 }
 
-                //Connected; trigger "connect" event
+                //Connected; flush data written while connecting and trigger "connect" event
+                //(Stops watching write readiness unless data is still pending)
                 data->status = Status::CONNECTED;
+                this->reactor_write();
+                this->resolve_writes();
                 this->trigger("connect");
             }
             //Write
             else
-            {   std::string& buffer = data->buffer;
-                size_t offset = 0;
-
-                while (true)
-                {   //Check buffer emptiness and fetch data for sending
-                    if (offset>=buffer.size())
-                        break;
-                    size_t write_len = std::min<size_t>(buffer.size()-offset, SOCK_BUFFER_SIZE);
-
-                    //Try writing to socket
-                    ssize_t count = ::write(data->fd, buffer.c_str()+offset, write_len);
-                    if (count==-1)
-                    {   if ((errno!=EAGAIN)&&(errno!=EWOULDBLOCK))
-                            throw SocketError(SocketError::Reason::WRITE);
-                        else
-                            break;
-                    }
-                    //Update offset
-                    offset += count;
-                }
-
-                //Update write buffer and bytes written count
-                buffer = buffer.substr(offset);
-                data->bytes_written += offset;
+            {   this->reactor_write();
                 //Resolve write promises
-                while (data->write_promise_queue.size()>0)
-                {   auto promise_item = data->write_promise_queue.front();
-                    //Target not reached
-                    if (promise_item.target>data->bytes_written)
-                        break;
-
-                    //Resolve write promise
-                    promise_item.ctx.resolve();
-                    //Pop item from queue
-                    data->write_promise_queue.pop();
-                }
+                this->resolve_writes();
+            }
+        }
+    }
+
+    //Connect to remote address
+    bool Socket::reactor_connect(const sockaddr_in& addr_obj)
+    {   auto data = this->data;
+
+        //Try to connect to remote
+        reactor::count_syscall();
+        if (::connect(data->fd, (sockaddr*)(&addr_obj), sizeof(sockaddr_in))<0)
+        {   //Still in process; watch write readiness for completion
+            if (errno==EINPROGRESS)
+            {   data->write_interest = true;
+                watch_write(data->fd, data->reg_data, true);
+                return false;
+            }
+            //Error connecting
+            else
+                throw SocketError(SocketError::Reason::CONNECT);
+        }
+
+        return true;
+    }
+
+    //Write buffered data to socket
+    bool Socket::reactor_write()
+    {   auto data = this->data;
+        std::string& buffer = data->buffer;
+        size_t offset = 0;
+
+        //Keep writing until finished or blocked
+        while (offset<buffer.size())
+        {   //Try writing to socket
+            reactor::count_syscall();
+            ssize_t count = ::write(data->fd, buffer.c_str()+offset, buffer.size()-offset);
+            if (count==-1)
+            {   if ((errno!=EAGAIN)&&(errno!=EWOULDBLOCK))
+                    throw SocketError(SocketError::Reason::WRITE);
+                else
+                    break;
             }
+            //Update offset
+            offset += count;
+        }
+
+        //Update write buffer and bytes written count
+        buffer.erase(0, offset);
+        data->bytes_written += offset;
+
+        //Watch write readiness only while data is pending
+        bool pending = !buffer.empty();
+        if ((data->status!=Status::CONNECTING)&&(data->fd>=0)&&(data->write_interest!=pending))
+        {   data->write_interest = pending;
+            watch_write(data->fd, data->reg_data, pending);
         }
+
+        return !pending;
+    }
+
+    //Close socket file descriptor
+    void Socket::reactor_close()
+    {   reactor::count_syscall();
+        if (::close(this->data->fd)<0)
+            throw SocketError(SocketError::Reason::CLOSE);
     }
 
     //Register server socket to reactor
@@ -154,14 +225,15 @@ namespace libasync
     {   epoll_event new_event;
         int fd = this->data->fd;
 
-        new_event.data.fd = fd;
+        //Add server socket to lookup table
+        new_event.data.u64 = epoll_table_add(fd, this->data->reactor_slot.attach(this->data));
         new_event.events = EPOLLIN|EPOLLET;
         //Add to epoll file descriptor
+        reactor::count_syscall();
         if (epoll_ctl(epoll_data->fd, EPOLL_CTL_ADD, fd, &new_event)<0)
+        {   reactor_unreg(fd);
             throw ReactorError(ReactorError::Reason::REG);
-
-        //Add server socket to lookup table
-        epoll_data->table[fd] = new ServerSocket(*this);
+        }
     }
 
     //Handle reactor event
@@ -172,6 +244,7 @@ namespace libasync
         {   sockaddr_in client_addr;
             socklen_t client_addr_len = sizeof(sockaddr_in);
 
+            reactor::count_syscall();
             int client_fd = accept(data->fd, (sockaddr*)(&client_addr), &client_addr_len);
             if (client_fd==-1)
             {   //No more incoming connections
@@ -183,24 +256,7 @@ namespace libasync
             }
 
             //Create socket for incoming connection
-            Socket client_sock(client_fd);
-            auto client_data = client_sock.data;
-
-            //Get client local address information
-            sockaddr_in addr_obj;
-            socklen_t addr_obj_len = sizeof(sockaddr_in);
-            //Failed to get local address and port
-            if (getsockname(client_fd, (sockaddr*)(&addr_obj), &addr_obj_len)<0)
-                throw SocketError(SocketError::Reason::GET_LOCAL_ADDR);
-            //Set client local address
-            client_data->local_addr = addr_obj.sin_addr.s_addr;
-            client_data->local_port = addr_obj.sin_port;
-
-            //Set client remote address
-            client_data->remote_addr = client_addr.sin_addr.s_addr;
-            client_data->remote_port = client_addr.sin_port;
-            //Trigger "connect" event
-            this->trigger("connect", client_sock);
+            this->accepted(client_fd, client_addr);
         }
     }
 }
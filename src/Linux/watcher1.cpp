@@ -0,0 +1,72 @@
+#include <sys/epoll.h>
+#include <libasync/watcher.h>
+#include <libasync/reactor.h>
+#include <libasync/Linux/reactor.h>
+
+namespace libasync
+{   //Get epoll events for watcher
+    static uint32_t watcher_events(bool readable, bool writable, FdWatcher::Mode mode)
+    {   uint32_t events = 0;
+
+        if (readable)
+            events |= EPOLLIN|EPOLLRDHUP;
+        if (writable)
+            events |= EPOLLOUT;
+        if (mode==FdWatcher::Mode::EDGE)
+            events |= EPOLLET;
+        return events;
+    }
+
+    //Register watcher to reactor
+    void FdWatcher::reactor_register()
+    {   auto data = this->data;
+        epoll_event new_event;
+
+        //Add watcher to lookup table
+        data->reg_data = epoll_table_add(data->fd, data->reactor_slot.attach(data));
+        new_event.data.u64 = data->reg_data;
+        new_event.events = watcher_events(data->readable, data->writable, data->mode);
+        //Add to epoll file descriptor
+        reactor::count_syscall();
+        if (epoll_ctl(epoll_data->fd, EPOLL_CTL_ADD, data->fd, &new_event)<0)
+        {   reactor_unreg(data->fd);
+            throw ReactorError(ReactorError::Reason::REG);
+        }
+    }
+
+    //Update watched events in reactor
+    void FdWatcher::reactor_update()
+    {   auto data = this->data;
+        epoll_event new_event;
+
+        new_event.data.u64 = data->reg_data;
+        new_event.events = watcher_events(data->readable, data->writable, data->mode);
+        reactor::count_syscall();
+        if (epoll_ctl(epoll_data->fd, EPOLL_CTL_MOD, data->fd, &new_event)<0)
+            throw ReactorError(ReactorError::Reason::MODIFY);
+    }
+
+    //Unregister watcher from reactor
+    void FdWatcher::reactor_stop()
+    {   int fd = this->data->fd;
+
+        //(File descriptor may already be closed by owner)
+        reactor::count_syscall();
+        epoll_ctl(epoll_data->fd, EPOLL_CTL_DEL, fd, nullptr);
+        reactor_unreg(fd);
+    }
+
+    //Handle reactor event
+    void FdWatcher::reactor_on_event(void* _event)
+    {   auto event = (epoll_event*)_event;
+        auto data = this->data;
+
+        //Trigger events (Watcher may be stopped by handlers)
+        if ((event->events&EPOLLIN)&&data->readable)
+            this->trigger("readable");
+        if ((event->events&EPOLLOUT)&&data->writable&&data->active)
+            this->trigger("writable");
+        if ((event->events&(EPOLLHUP|EPOLLRDHUP|EPOLLERR))&&data->active)
+            this->trigger("hangup");
+    }
+}
@@ -0,0 +1,29 @@
+#include <memory>
+#include <mutex>
+#include <libasync/blocking.h>
+
+namespace libasync
+{   namespace blocking
+    {   //Lock for fields below
+        static std::mutex pool_lock;
+        //Amount of blocking pool threads
+        static size_t pool_size = BLOCKING_POOL_SIZE;
+        //Blocking pool (Never released; threads may be blocked in calls that cannot be interrupted)
+        static ThreadPoolLoop* blocking_pool = nullptr;
+
+        //Get blocking pool
+        ThreadPoolLoop pool()
+        {   std::lock_guard<std::mutex> guard(pool_lock);
+            if (!blocking_pool)
+                blocking_pool = new ThreadPoolLoop(pool_size);
+            return *blocking_pool;
+        }
+    }
+
+    //Set amount of blocking pool threads
+    void blocking_init(size_t n_threads)
+    {   std::lock_guard<std::mutex> guard(blocking::pool_lock);
+        if (n_threads>0)
+            blocking::pool_size = n_threads;
+    }
+}
@@ -0,0 +1,56 @@
+#include <utility>
+#include <libasync/cancel.h>
+
+namespace libasync
+{   //Get error information
+    const char* CancelledError::what() const noexcept
+    {   return "Operation cancelled";
+    }
+
+    //Cancel token constructor
+    CancelToken::CancelToken() : data(std::make_shared<CancelTokenData>()) {}
+
+    //Cancel
+    void CancelToken::cancel()
+    {   auto data = this->data;
+        if (data->cancelled)
+            return;
+        data->cancelled = true;
+
+        //Take callbacks one by one (Callbacks may remove others meanwhile)
+        auto& callbacks = data->callbacks;
+        while (!callbacks.empty())
+        {   auto callback_ptr = callbacks.begin();
+            Callback callback(std::move(callback_ptr->second));
+
+            callbacks.erase(callback_ptr);
+            callback();
+        }
+    }
+
+    //Check if cancelled
+    bool CancelToken::cancelled()
+    {   return this->data->cancelled;
+    }
+
+    //Add cancel callback
+    size_t CancelToken::on_cancel(CancelToken::Callback callback)
+    {   auto data = this->data;
+
+        //Already cancelled; call back at once
+        if (data->cancelled)
+        {   callback();
+            return 0;
+        }
+
+        size_t handle = data->counter;
+        data->counter++;
+        data->callbacks[handle] = std::move(callback);
+        return handle;
+    }
+
+    //Remove cancel callback
+    bool CancelToken::off_cancel(size_t handle)
+    {   return this->data->callbacks.erase(handle)>0;
+    }
+}
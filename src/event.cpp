@@ -5,6 +5,9 @@ namespace libasync
 {   //Internal constructor
     EventMixin::EventMixin() : data(std::make_shared<EventMixinData>()) {}
 
+    //Internal constructor (Event data stored inside data of derived class)
+    EventMixin::EventMixin(EventMixin::EventMixinDataRef _data) : data(_data) {}
+
     //Trigger event
     void EventMixin::trigger(std::string event)
     {   return this->trigger(event, boost::any());
@@ -12,14 +15,14 @@ namespace libasync
 
     //Remove event listener
     bool EventMixin::off(std::string event, size_t handle)
-    {   auto store = this->data->store;
+    {   auto& store = this->data->store;
 
         //Find event handler store
         auto result_ptr = store.find(event);
         if (result_ptr==store.end())
             return false;
         //Find event handler
-        EventHandlerStore& event_store = store[event];
+        EventHandlerStore& event_store = result_ptr->second;
         auto handler_ptr = event_store.find(handle);
         if (handler_ptr==event_store.end())
             return false;
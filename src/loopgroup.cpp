@@ -0,0 +1,187 @@
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include <libasync/loopgroup.h>
+#include <libasync/promise.h>
+#include <libasync/reactor.h>
+#include <libasync/signals.h>
+#include <libasync/timer.h>
+
+namespace libasync
+{   //Pin current thread to given CPU (Best effort; Linux only)
+    static void pin_thread(size_t cpu)
+    {
+#ifdef __linux__
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+#endif
+    }
+
+    //Loop group data destructor
+    LoopGroup::LoopGroupData::~LoopGroupData()
+    {   for (auto& loop : this->loops)
+            loop.stop();
+        for (auto& thread : this->threads)
+            //(Released from a thread of this group; cannot wait for itself)
+            if (thread.get_id()==std::this_thread::get_id())
+                thread.detach();
+            else if (thread.joinable())
+                thread.join();
+    }
+
+    //Thread main function
+    void LoopGroup::thread_main(LoopGroup::LoopGroupData* data, size_t index, LoopGroup::ListenersRef listeners,
+        LoopGroup::ThreadTask init)
+    {   TaskLoop loop = TaskLoop::thread_loop();
+
+        //Initialize modules for this thread
+        try
+        {   promise_init();
+            reactor_init();
+            timer_init();
+            if (init)
+                init(index);
+        }
+        catch (...)
+        {   std::lock_guard<std::mutex> guard(data->lock);
+            if (!data->error)
+                data->error = std::current_exception();
+        }
+
+        //Publish task loop
+        bool failed;
+        {   std::lock_guard<std::mutex> guard(data->lock);
+            data->loops[index] = loop;
+            data->n_ready++;
+            failed = bool(data->error);
+            data->cond.notify_all();
+        }
+        if (failed)
+            return;
+
+        loop.run();
+
+        //Close listening sockets
+        for (auto& server : *listeners)
+            if (server.status()==ServerSocket::Status::LISTENING)
+                server.close();
+    }
+
+    //Constructor
+    LoopGroup::LoopGroup(size_t n_threads, LoopGroup::ThreadTask init) : data(std::make_shared<LoopGroupData>())
+    {   auto data = this->data;
+
+        if (n_threads==0)
+            n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        data->loops.resize(n_threads);
+        for (size_t i=0;i<n_threads;i++)
+            data->listeners.push_back(std::make_shared<std::vector<ServerSocket>>());
+
+        //Start threads and wait until all are initialized
+        //(Threads start with asynchronous signals blocked, so signals handled through a reactor never reach them)
+        {   signals::BlockScope block_scope;
+            for (size_t i=0;i<n_threads;i++)
+                data->threads.emplace_back(thread_main, data.get(), i, data->listeners[i], init);
+        }
+        std::unique_lock<std::mutex> guard(data->lock);
+        data->cond.wait(guard, [=]()
+        {   return data->n_ready==n_threads;
+        });
+
+        //Initialization failed; shut down and rethrow
+        if (data->error)
+        {   guard.unlock();
+            this->stop();
+            this->join();
+            std::rethrow_exception(data->error);
+        }
+    }
+
+    //Get amount of threads
+    size_t LoopGroup::size()
+    {   return this->data->loops.size();
+    }
+
+    //Get task loop of given thread
+    TaskLoop LoopGroup::loop(size_t index)
+    {   return this->data->loops.at(index);
+    }
+
+    //Get task loops of all threads
+    std::vector<TaskLoop> LoopGroup::loops()
+    {   return this->data->loops;
+    }
+
+    //Run task on each thread and wait until all finish
+    void LoopGroup::each(LoopGroup::ThreadTask task)
+    {   auto data = this->data;
+        size_t n_pending = data->loops.size();
+        std::exception_ptr error;
+
+        for (size_t i=0;i<data->loops.size();i++)
+            data->loops[i].post([=, &n_pending, &error]()
+            {   std::exception_ptr result;
+                try
+                {   task(i);
+                }
+                catch (...)
+                {   result = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> guard(data->lock);
+                if (result&&!error)
+                    error = result;
+                n_pending--;
+                data->cond.notify_all();
+            });
+
+        //Wait for all threads
+        std::unique_lock<std::mutex> guard(data->lock);
+        data->cond.wait(guard, [&]()
+        {   return n_pending==0;
+        });
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    //Listen on each thread with SO_REUSEPORT sharding
+    void LoopGroup::listen(in_addr_t addr, in_port_t port, LoopGroup::ConnectHandler handler, int backlog, bool steer_cpu)
+    {   auto data = this->data;
+
+        this->each([=](size_t index)
+        {   ServerSocket server;
+
+            server.reuse_port();
+            //Serve connections steered to CPU on that CPU
+            if (steer_cpu)
+            {   size_t cpu = index%std::max(std::thread::hardware_concurrency(), 1u);
+                pin_thread(cpu);
+                server.incoming_cpu(cpu);
+            }
+            //"connect" event fires on this thread
+            server.on("connect", [=](Socket client)
+            {   handler(client);
+            });
+            server.listen(addr, port, backlog);
+
+            data->listeners[index]->push_back(server);
+        });
+    }
+
+    //Stop all loops
+    void LoopGroup::stop()
+    {   for (auto& loop : this->data->loops)
+            loop.stop();
+    }
+
+    //Wait for all threads to exit
+    void LoopGroup::join()
+    {   for (auto& thread : this->data->threads)
+            if (thread.joinable())
+                thread.join();
+    }
+}
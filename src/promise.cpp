@@ -1,24 +1,187 @@
+#include <new>
 #include <libasync/promise.h>
 
 namespace libasync
 {   namespace promise
-    {   //Pending callback queue
-        thread_local std::list<promise::PromiseDataBaseRef>* pending_callback_queue = nullptr;
+    {   //Pool size class granularity (Bytes)
+        static const size_t POOL_GRANULE = 16;
+        //Largest pooled size (Bytes; larger promise data is allocated directly)
+        static const size_t POOL_MAX_SIZE = 256;
+        //Amount of size classes
+        static const size_t POOL_N_CLASSES = POOL_MAX_SIZE/POOL_GRANULE;
+        //Maximum free blocks kept per size class
+        static const size_t POOL_MAX_FREE = 4096;
+
+        //Free block type
+        struct FreeBlock
+        {   //Next free block
+            FreeBlock* next;
+        };
+
+        //Promise data pool type (Free list per size class)
+        struct PromisePool
+        {   //Free lists
+            FreeBlock* free_lists[POOL_N_CLASSES];
+            //Amount of free blocks in each list
+            size_t n_free[POOL_N_CLASSES];
+
+            //Constructor
+            PromisePool();
+            //Destructor
+            ~PromisePool();
+        };
+
+        //Pending callback queue
+        thread_local std::vector<promise::PromiseDataBaseRef>* pending_callback_queue = nullptr;
+        //Index of first pending callback not yet called back
+        static thread_local size_t pending_callback_head = 0;
+        //Inline callback limit of current thread
+        thread_local size_t inline_limit = 0;
+        //Inline callback queue
+        thread_local std::vector<PromiseDataBaseRef>* inline_queue = nullptr;
+        //Inline callback queue being drained
+        static thread_local bool inline_draining = false;
+        //Promise data pool of current thread
+        static thread_local PromisePool promise_pool;
+        //Promise data pool of current thread destroyed
+        //(Promise data released later during thread exit bypasses the pool)
+        static thread_local bool pool_destroyed = false;
+
+        //Promise data pool constructor
+        PromisePool::PromisePool()
+        {   for (size_t i=0;i<POOL_N_CLASSES;i++)
+            {   this->free_lists[i] = nullptr;
+                this->n_free[i] = 0;
+            }
+        }
+
+        //Promise data pool destructor
+        PromisePool::~PromisePool()
+        {   for (size_t i=0;i<POOL_N_CLASSES;i++)
+                while (this->free_lists[i])
+                {   FreeBlock* block = this->free_lists[i];
+                    this->free_lists[i] = block->next;
+                    ::operator delete(block);
+                }
+            pool_destroyed = true;
+        }
+
+        //Allocate promise data from pool of current thread
+        void* pool_alloc(size_t size)
+        {   if ((size>POOL_MAX_SIZE)||pool_destroyed)
+                return ::operator new(size);
+
+            size_t index = (size-1)/POOL_GRANULE;
+            FreeBlock* block = promise_pool.free_lists[index];
+            //Free list empty; allocate block of full class size
+            if (!block)
+                return ::operator new((index+1)*POOL_GRANULE);
+
+            promise_pool.free_lists[index] = block->next;
+            promise_pool.n_free[index]--;
+            return block;
+        }
+
+        //Return promise data to pool of current thread
+        //(Blocks may be returned by another thread than the allocating one; both hold blocks of the same class size)
+        void pool_free(void* ptr, size_t size)
+        {   if ((size>POOL_MAX_SIZE)||pool_destroyed)
+            {   ::operator delete(ptr);
+                return;
+            }
+
+            size_t index = (size-1)/POOL_GRANULE;
+            //Enough free blocks kept
+            if (promise_pool.n_free[index]>=POOL_MAX_FREE)
+            {   ::operator delete(ptr);
+                return;
+            }
+
+            auto block = static_cast<FreeBlock*>(ptr);
+            block->next = promise_pool.free_lists[index];
+            promise_pool.free_lists[index] = block;
+            promise_pool.n_free[index]++;
+        }
+
+        //Idle check of promise module (Pending callbacks need a round without blocking)
+        static int promise_idle(void* arg)
+        {   return (pending_callback_head==pending_callback_queue->size())?-1:0;
+        }
 
         //Promise task
+        //(Promise callbacks are urgent work; callbacks queued meanwhile or over budget of urgent lane are left for
+        // next round, so chains settling promises over and over cannot starve other tasks and reactor polling)
         void promise_task()
-        {   //Trigger all callbacks
-            for (auto data : *pending_callback_queue)
+        {   auto& queue = *pending_callback_queue;
+            auto& head = pending_callback_head;
+
+            //Amount of callbacks to trigger
+            size_t count = queue.size()-head;
+            size_t budget = TaskLoop::thread_loop().lane_budget(TaskLoop::Priority::URGENT);
+            if ((budget>0)&&(budget<count))
+                count = budget;
+
+            for (size_t end=head+count;head<end;)
+            {   //(Queue may grow and relocate while calling back)
+                PromiseDataBaseRef data = std::move(queue[head++]);
                 data->call_back();
-            pending_callback_queue->clear();
+            }
+            //All called back; reuse queue from start
+            if (head==queue.size())
+            {   queue.clear();
+                head = 0;
+            }
+            //Drop called back entries once they take up half of queue
+            else if (head>=queue.size()/2)
+            {   queue.erase(queue.begin(), queue.begin()+head);
+                head = 0;
+            }
+        }
+
+        //Call back promise within the settling call
+        void call_back_inline(PromiseDataBaseRef data)
+        {   auto& queue = *inline_queue;
+
+            queue.push_back(std::move(data));
+            //Settled by an inline callback; called back by outermost call after that callback returns
+            //(References held by nested callers are released by then, so values can be moved)
+            if (inline_draining)
+                return;
+
+            inline_draining = true;
+            size_t i = 0;
+            try
+            {   for (;i<queue.size();i++)
+                {   //(Queue may grow and relocate while calling back)
+                    PromiseDataBaseRef data = std::move(queue[i]);
+                    data->call_back();
+                }
+            }
+            catch (...)
+            {   //Leave remaining promises to promise task
+                for (i++;i<queue.size();i++)
+                    pending_callback_queue->push_back(std::move(queue[i]));
+                queue.clear();
+                inline_draining = false;
+                throw;
+            }
+            queue.clear();
+            inline_draining = false;
         }
     }
 
     //Initialize promise module for current thread
     void promise_init()
     {   //Initialize pending callback queue
-        promise::pending_callback_queue = new std::list<promise::PromiseDataBaseRef>();
-        //Add promise task to task loop
+        promise::pending_callback_queue = new std::vector<promise::PromiseDataBaseRef>();
+        promise::inline_queue = new std::vector<promise::PromiseDataBaseRef>();
+        //Add promise task and idle check to task loop
         TaskLoop::thread_loop().add(promise::promise_task);
+        TaskLoop::thread_loop().add_idle_check(promise::promise_idle, nullptr);
+    }
+
+    //Set inline callback limit of current thread
+    void promise_set_inline_limit(size_t max_callbacks)
+    {   promise::inline_limit = max_callbacks;
     }
 }
@@ -1,8 +1,201 @@
 #include <string.h>
+#include <sys/socket.h>
+#include <algorithm>
 #include <libasync/reactor.h>
+#include <libasync/taskloop.h>
 
 namespace libasync
-{   //Reactor exception constructor
+{   //Consecutive underused waits before shrinking event batch
+    static const size_t N_UNDERUSED_WAITS = 16;
+
+    namespace reactor
+    {   //Reactor wait state
+        thread_local WaitState wait_state;
+        //Reactor statistics
+        thread_local ReactorStats stats;
+
+        //Get monotonic time in nanoseconds
+        static uint64_t clock_ns()
+        {   return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        //Get timeout for next reactor wait
+        int wait_timeout(bool ready)
+        {   int timeout = ready?0:TaskLoop::thread_loop().idle_timeout();
+            auto& state = wait_state;
+
+            //Record system calls of previous round
+            stats.syscalls_per_round.record(stats.n_syscalls-state.round_syscalls);
+            state.round_syscalls = stats.n_syscalls;
+
+            //Keep polling for a while after last event
+            if ((state.policy.spin_us>0)&&(timeout!=0))
+            {   auto idle = std::chrono::steady_clock::now()-state.last_event;
+                if (idle<std::chrono::microseconds(state.policy.spin_us))
+                    return 0;
+            }
+            //Let posting threads wake up loop while blocked
+            if (timeout!=0)
+            {   if (!TaskLoop::thread_loop().sleep_begin())
+                    return 0;
+                state.sleeping = true;
+            }
+            if (state.timing)
+                state.wait_start = clock_ns();
+            return timeout;
+        }
+
+        //Update wait state with amount of events returned by last wait
+        void wait_done(size_t n_events)
+        {   auto& state = wait_state;
+
+            //Update statistics
+            stats.n_waits++;
+            stats.n_events += n_events;
+            stats.events_per_wait.record(n_events);
+            count_syscall();
+            if (state.timing)
+                stats.wait_ns.record(clock_ns()-state.wait_start);
+
+            //Leave sleeping state
+            if (state.sleeping)
+            {   TaskLoop::thread_loop().sleep_end();
+                state.sleeping = false;
+            }
+            //Record time of last event for spinning
+            if ((n_events>0)&&(state.policy.spin_us>0))
+                state.last_event = std::chrono::steady_clock::now();
+
+            //Batch filled; grow batch
+            if (n_events>=state.batch_size)
+            {   state.batch_size = std::min(state.batch_size*2, state.policy.max_batch);
+                state.n_underused = 0;
+            }
+            //Batch underused for a while; shrink batch
+            else if (n_events<state.batch_size/4)
+            {   state.n_underused++;
+                if (state.n_underused>=N_UNDERUSED_WAITS)
+                {   state.batch_size = std::max(state.batch_size/2, state.policy.min_batch);
+                    state.n_underused = 0;
+                }
+            }
+            else
+                state.n_underused = 0;
+        }
+
+        //Call event handler of reactor target
+        void dispatch(ReactorTarget* target, void* event)
+        {   stats.n_dispatches++;
+            if (!wait_state.timing)
+            {   target->reactor_on_event(event);
+                return;
+            }
+
+            uint64_t start = clock_ns();
+            target->reactor_on_event(event);
+            stats.dispatch_ns.record(clock_ns()-start);
+        }
+
+        //Release reactor target after unregistration
+        void release(ReactorTarget* target)
+        {   target->reactor_release();
+        }
+
+        //Enable socket busy polling if requested by wait policy
+        //(Best effort; requires privileges beyond system default)
+        void set_busy_poll(int fd)
+        {
+#ifdef SO_BUSY_POLL
+            int busy_poll_us = wait_state.policy.busy_poll_us;
+            if (busy_poll_us>0)
+                setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_us, sizeof(int));
+#endif
+        }
+    }
+
+    //Histogram constructor
+    ReactorHistogram::ReactorHistogram() : count(0), sum(0), max(0)
+    {   memset(this->buckets, 0, sizeof(this->buckets));
+    }
+
+    //Record a value
+    void ReactorHistogram::record(uint64_t value)
+    {   unsigned index;
+
+        //Small values map to buckets directly
+        if (value<(uint64_t(1)<<SUB_BITS))
+            index = value;
+        //Power of 2 group and linear sub-bucket inside group
+        else
+        {   unsigned msb = 63-__builtin_clzll(value);
+            index = ((msb-SUB_BITS+1)<<SUB_BITS)|((value>>(msb-SUB_BITS))&((1<<SUB_BITS)-1));
+        }
+
+        this->buckets[index]++;
+        this->count++;
+        this->sum += value;
+        if (value>this->max)
+            this->max = value;
+    }
+
+    //Get value at given quantile
+    uint64_t ReactorHistogram::quantile(double q) const
+    {   if (this->count==0)
+            return 0;
+
+        uint64_t rank = q*(this->count-1);
+        uint64_t seen = 0;
+        for (unsigned index=0;index<N_BUCKETS;index++)
+        {   seen += this->buckets[index];
+            if (seen>rank)
+            {   unsigned group = index>>SUB_BITS;
+                uint64_t sub = index&((1<<SUB_BITS)-1);
+                //Lower bound of bucket
+                return (group==0)?sub:(((uint64_t(1)<<SUB_BITS)|sub)<<(group-1));
+            }
+        }
+        return this->max;
+    }
+
+    //Get mean of recorded values
+    double ReactorHistogram::mean() const
+    {   return (this->count==0)?0:double(this->sum)/this->count;
+    }
+
+    //Set reactor wait policy for current thread
+    void reactor_set_policy(ReactorPolicy policy)
+    {   auto& state = reactor::wait_state;
+
+        //Normalize batch size limits
+        policy.min_batch = std::max<size_t>(policy.min_batch, 1);
+        policy.max_batch = std::max(policy.max_batch, policy.min_batch);
+        //Set policy and clamp current batch size
+        state.policy = policy;
+        state.batch_size = std::min(std::max(state.batch_size, policy.min_batch), policy.max_batch);
+    }
+
+    //Get reactor wait policy of current thread
+    ReactorPolicy reactor_policy()
+    {   return reactor::wait_state.policy;
+    }
+
+    //Enable or disable wait and dispatch timing for current thread
+    void reactor_set_timing(bool enabled)
+    {   reactor::wait_state.timing = enabled;
+    }
+
+    //Get snapshot of reactor statistics of current thread
+    ReactorStats reactor_stats()
+    {   return reactor::stats;
+    }
+
+    //Reset reactor statistics of current thread
+    void reactor_reset_stats()
+    {   reactor::stats = ReactorStats();
+        reactor::wait_state.round_syscalls = 0;
+    }
+
+    //Reactor exception constructor
     ReactorError::ReactorError(Reason __reason, int __error_num)
         : _reason(__reason), _error_num(__error_num) {}
 
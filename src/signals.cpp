@@ -0,0 +1,122 @@
+#include <libasync/signals.h>
+
+namespace libasync
+{   namespace signals
+    {   //Signal data of current thread
+        thread_local SignalData* signal_data = nullptr;
+
+        //Put handler back after it runs (Unless it was removed meanwhile)
+        static void restore_handler(int signum, size_t handle, SignalHandler& handler)
+        {   auto store_ptr = signal_data->handlers.find(signum);
+            if (store_ptr==signal_data->handlers.end())
+                return;
+            auto handler_ptr = store_ptr->second.find(handle);
+            if (handler_ptr!=store_ptr->second.end())
+                handler_ptr->second.swap(handler);
+        }
+
+        //Call handlers of given signal
+        void dispatch(int signum)
+        {   if (!signal_data)
+                return;
+
+            //Call back handlers added before delivery
+            //(Handlers may add or remove handlers; each is moved out while it runs)
+            //(Store of signal is dropped with its last handler, so it is looked up again after each handler)
+            auto& handlers = signal_data->handlers;
+            size_t end_handle = signal_data->counter;
+            size_t handle = 0;
+            while (true)
+            {   auto store_ptr = handlers.find(signum);
+                if (store_ptr==handlers.end())
+                    return;
+                auto& store = store_ptr->second;
+
+                //Skip handlers running in an outer delivery
+                auto handler_ptr = store.upper_bound(handle);
+                while ((handler_ptr!=store.end())&&(handler_ptr->first<=end_handle)&&(!handler_ptr->second))
+                    handler_ptr++;
+                if ((handler_ptr==store.end())||(handler_ptr->first>end_handle))
+                    return;
+
+                handle = handler_ptr->first;
+                SignalHandler handler;
+                handler.swap(handler_ptr->second);
+                try
+                {   handler(signum);
+                }
+                catch (...)
+                {   restore_handler(signum, handle, handler);
+                    throw;
+                }
+                restore_handler(signum, handle, handler);
+            }
+        }
+
+        //Signal block scope constructor
+        BlockScope::BlockScope()
+        {   sigset_t block_mask;
+
+            //Block all signals except ones raised synchronously by faults of the thread itself
+            sigfillset(&block_mask);
+            sigdelset(&block_mask, SIGSEGV);
+            sigdelset(&block_mask, SIGBUS);
+            sigdelset(&block_mask, SIGFPE);
+            sigdelset(&block_mask, SIGILL);
+            sigdelset(&block_mask, SIGTRAP);
+            sigdelset(&block_mask, SIGSYS);
+            sigdelset(&block_mask, SIGABRT);
+            pthread_sigmask(SIG_BLOCK, &block_mask, &this->old_mask);
+        }
+
+        //Signal block scope destructor
+        BlockScope::~BlockScope()
+        {   pthread_sigmask(SIG_SETMASK, &this->old_mask, nullptr);
+        }
+    }
+
+    //Add signal handler on current thread
+    size_t on_signal(int signum, SignalHandler handler)
+    {   if (!signals::signal_data)
+            signals::signal_data = new signals::SignalData();
+        auto data = signals::signal_data;
+
+        //First handler of signal; start receiving it
+        auto& store = data->handlers[signum];
+        if (store.empty())
+            signals::signal_watch(signum);
+
+        size_t handle = ++data->counter;
+        store[handle] = handler;
+        return handle;
+    }
+
+    //Remove signal handler
+    bool off_signal(int signum, size_t handle)
+    {   auto data = signals::signal_data;
+        if (!data)
+            return false;
+        auto store_ptr = data->handlers.find(signum);
+        if ((store_ptr==data->handlers.end())||(store_ptr->second.erase(handle)==0))
+            return false;
+
+        //Last handler of signal removed; stop receiving it
+        if (store_ptr->second.empty())
+        {   data->handlers.erase(store_ptr);
+            signals::signal_unwatch(signum);
+        }
+        return true;
+    }
+
+    //Wait for next delivery of given signal
+    Promise<int> next_signal(int signum)
+    {   return Promise<int>([=](PromiseCtx<int> ctx)
+        {   auto handle = std::make_shared<size_t>();
+
+            *handle = on_signal(signum, [=](int delivered) mutable
+            {   off_signal(signum, *handle);
+                ctx.resolve(delivered);
+            });
+        });
+    }
+}
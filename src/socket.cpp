@@ -2,15 +2,14 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <fcntl.h>
+#include <arpa/inet.h>
 #include <unistd.h>
 #include <algorithm>
+#include <iterator>
 #include <libasync/socket.h>
 
 namespace libasync
-{   //Buffer size
-    static const size_t N_BYTES_PER_ROUND = 4096;
-
-    //Socket exception constructor
+{   //Socket exception constructor
     SocketError::SocketError(Reason __reason, int __error_num)
         : _reason(__reason), _error_num(__error_num) {}
 
@@ -30,7 +29,7 @@ namespace libasync
     }
 
     //Socket constructor
-    Socket::Socket() : data(std::make_shared<SocketData>())
+    Socket::Socket() : Socket(std::make_shared<SocketData>())
     {   //Create socket file descriptor
         int fd = socket(AF_INET, SOCK_STREAM, 0);
         if (fd==-1)
@@ -41,13 +40,18 @@ namespace libasync
     }
 
     //Socket internal constructor
-    Socket::Socket(int fd) : data(std::make_shared<SocketData>())
+    Socket::Socket(int fd) : Socket(std::make_shared<SocketData>())
     {   this->data->fd = fd;
         this->data->status = Status::CONNECTED;
 
         this->create();
     }
 
+    //Socket internal constructor
+    //(Event data shares allocation and lifetime of socket data)
+    Socket::Socket(SocketDataRef _data)
+        : EventMixin(EventMixinDataRef(_data, &_data->events)), data(_data) {}
+
     //Shared socket initialization logic
     void Socket::create()
     {   int fd = this->data->fd;
@@ -124,8 +128,19 @@ namespace libasync
 
     //Connect to given address and port
     Promise<void> Socket::connect(in_addr_t addr, in_port_t port)
+    {   return this->connect_impl(addr, port, nullptr);
+    }
+
+    Promise<void> Socket::connect(in_addr_t addr, in_port_t port, CancelToken token)
+    {   return this->connect_impl(addr, port, &token);
+    }
+
+    //Connect to given address and port (Implementation)
+    Promise<void> Socket::connect_impl(in_addr_t addr, in_port_t port, CancelToken* token)
     {   auto data = this->data;
-        bool connected = true;
+        //Already cancelled
+        if (token&&token->cancelled())
+            return Promise<void>::rejected(CancelledError());
         //Already connected; do nothing
         if (data->status!=Status::IDLE)
             return Promise<void>::resolved();
@@ -135,22 +150,15 @@ namespace libasync
         addr_obj.sin_family = AF_INET;
         addr_obj.sin_addr.s_addr = addr;
         addr_obj.sin_port = port;
-        //Try to connect to remote
-        if (::connect(data->fd, (sockaddr*)(&addr_obj), sizeof(sockaddr_in))<0)
-        {   //Still in process
-            if (errno==EINPROGRESS)
-                connected = false;
-            //Error connecting
-            else
-                throw SocketError(SocketError::Reason::CONNECT);
-        }
+        //Set remote address and port
+        data->remote_addr = addr;
+        data->remote_port = port;
 
-        //Connected
-        if (connected)
+        //Try to connect to remote
+        //(Connected)
+        if (this->reactor_connect(addr_obj))
         {   //Updtae socket status
             data->status = Status::CONNECTED;
-            data->remote_addr = addr;
-            data->remote_port = port;
             //Trigger connect event
             this->trigger("connect");
 
@@ -161,61 +169,188 @@ namespace libasync
         {   data->status = Status::CONNECTING;
 
             return Promise<void>([=](PromiseCtx<void> ctx) mutable
-            {   //Listen to connect event
-                this->on("connect", [=]() mutable
-                {   ctx.resolve();
+            {   //Not cancellable; listen to connect event
+                if (!token)
+                {   this->on("connect", [=]() mutable
+                    {   ctx.resolve();
+                    });
+                    return;
+                }
+
+                //Stop watching token once connecting finishes
+                //(Connect and error handlers share the registration; removing both releases it)
+                CancelToken cancel_token = *token;
+                auto cancel_handle = std::make_shared<size_t>(0);
+                std::shared_ptr<void> cancel_reg(nullptr, [=](void*) mutable
+                {   cancel_token.off_cancel(*cancel_handle);
+                });
+                //Remove connect and error handlers (Token and handlers do not keep socket alive)
+                std::weak_ptr<SocketData> weak_data = data;
+                auto handles = std::make_shared<std::pair<size_t, size_t>>(0, 0);
+                auto finish = [=]()
+                {   auto data = weak_data.lock();
+                    if (!data)
+                        return;
+                    Socket socket(data);
+                    socket.off("connect", handles->first);
+                    socket.off("error", handles->second);
+                };
+
+                //Listen to connect event
+                handles->first = this->on("connect", [=]() mutable
+                {   //(Keeps cancel registration)
+                    (void)cancel_reg;
+                    finish();
+                    ctx.resolve();
+                });
+                //Failed to connect
+                handles->second = this->on("error", [=]() mutable
+                {   //(Keeps cancel registration)
+                    (void)cancel_reg;
+                    finish();
+                });
+                //Abort connecting when cancelled
+                *cancel_handle = cancel_token.on_cancel([=]() mutable
+                {   finish();
+                    auto data = weak_data.lock();
+                    if (data)
+                        Socket(data).abort_connect();
+                    ctx.reject(CancelledError());
                 });
             });
         }
     }
 
+    //Abort connecting
+    void Socket::abort_connect()
+    {   auto data = this->data;
+        if (data->status!=Status::CONNECTING)
+            return;
+
+        //Unregister socket from reactor and close it
+        reactor_unreg(data->fd);
+        this->reactor_close();
+        data->fd = -1;
+        data->status = Status::CLOSED;
+        data->load_token.reset();
+
+        //Drop data written while connecting and reject its promises
+        std::list<PromiseQueueItem> queue;
+        queue.swap(data->write_promise_queue);
+        data->buffer.clear();
+        for (auto& item : queue)
+            item.ctx.reject(CancelledError());
+
+        this->trigger("close");
+    }
+
     //Write data to socket
     Promise<void> Socket::write(std::string data)
+    {   return this->write_impl(std::move(data), nullptr);
+    }
+
+    Promise<void> Socket::write(std::string data, CancelToken token)
+    {   return this->write_impl(std::move(data), &token);
+    }
+
+    //Write data to socket (Implementation)
+    Promise<void> Socket::write_impl(std::string data, CancelToken* token)
     {   auto sock_data = this->data;
-        std::string& buffer = sock_data->buffer;
-        size_t offset = 0;
-        bool completed = false;
+        //Already cancelled; nothing is written
+        if (token&&token->cancelled())
+            return Promise<void>::rejected(CancelledError());
 
         //Append data to end of the buffer
+        size_t write_start = sock_data->bytes_written+this->buffer_size();
+        size_t write_target = write_start+data.size();
         sock_data->buffer += data;
-        //Keep writing until finished or blocked
-        while (true)
-        {   unsigned int write_len = std::min<size_t>(N_BYTES_PER_ROUND, buffer.size()-offset);
-            //Write data to socket
-            int count = ::write(sock_data->fd, buffer.c_str()+offset, write_len);
-            if (count==-1)
-            {   //Write error
-                if ((errno!=EAGAIN)&&(errno!=EWOULDBLOCK))
-                    throw SocketError(SocketError::Reason::WRITE);
-                else
-                    break;
-            }
-
-            //Move offset pointer
-            offset += count;
-            //Check if all data in buffer is written to socket
-            completed = offset>=buffer.size();
-            if (completed)
-                break;
-        }
-
-        //Update written bytes count
-        sock_data->bytes_written += offset;
-        //Update buffer
-        buffer = buffer.substr(offset);
-
-        //Completed
+        //Write buffered data to socket
+        bool completed = this->reactor_write();
+        //Resolve earlier writes flushed along with this one first
+        //(Write readiness is no longer watched once the buffer is drained)
+        this->resolve_writes();
+        //(Completed)
         if (completed)
             return Promise<void>::resolved();
         //Not completed; wait for reactor to resolve the promise
         else
-        {   size_t write_target = sock_data->bytes_written+buffer.size();
+        {   uint64_t id = sock_data->next_write_id++;
+
             return Promise<void>([=](PromiseCtx<void> ctx)
-            {   sock_data->write_promise_queue.push(PromiseQueueItem(write_target, ctx));
+            {   auto& queue = sock_data->write_promise_queue;
+                queue.push_back(PromiseQueueItem(write_start, write_target, ctx, id));
+                if (!token)
+                    return;
+
+                //Cancel write when token is cancelled; stop watching token once item is released
+                //(Token does not keep socket alive)
+                CancelToken cancel_token = *token;
+                std::weak_ptr<SocketData> weak_data = sock_data;
+                size_t handle = cancel_token.on_cancel([=]()
+                {   auto data = weak_data.lock();
+                    if (data)
+                        Socket(data).cancel_write(id);
+                });
+                queue.back().cancel_reg = std::shared_ptr<void>(nullptr, [=](void*) mutable
+                {   cancel_token.off_cancel(handle);
+                });
             });
         }
     }
 
+    //Cancel pending write
+    void Socket::cancel_write(uint64_t id)
+    {   auto data = this->data;
+        auto& queue = data->write_promise_queue;
+
+        //Write already finished
+        auto item_ptr = std::find_if(queue.begin(), queue.end(), [=](const PromiseQueueItem& item)
+        {   return item.id==id;
+        });
+        if (item_ptr==queue.end())
+            return;
+
+        //Drop bytes of this write still in buffer
+        //(Bytes handed to system or being sent by completion-based reactors cannot be taken back)
+        size_t buffer_start = data->bytes_written+data->send_buffer.size();
+        size_t drop_start = std::max(item_ptr->start, buffer_start);
+        size_t n_dropped = (item_ptr->target>drop_start)?(item_ptr->target-drop_start):0;
+        data->buffer.erase(drop_start-buffer_start, n_dropped);
+        //Later writes move forward
+        for (auto it=std::next(item_ptr);it!=queue.end();++it)
+        {   it->start -= n_dropped;
+            it->target -= n_dropped;
+        }
+
+        PromiseCtx<void> ctx = item_ptr->ctx;
+        queue.erase(item_ptr);
+        //Stop watching write readiness if nothing is left to send, then resolve earlier writes flushed meanwhile
+        if ((n_dropped>0)&&((data->status==Status::CONNECTED)||(data->status==Status::HALF_CLOSED))&&(data->fd>=0))
+        {   this->reactor_write();
+            this->resolve_writes();
+        }
+
+        ctx.reject(CancelledError());
+    }
+
+    //Resolve write promises whose target is reached
+    void Socket::resolve_writes()
+    {   auto data = this->data;
+
+        auto& queue = data->write_promise_queue;
+        while (queue.size()>0)
+        {   //Target not reached
+            if (queue.front().target>data->bytes_written)
+                break;
+
+            //Pop item from queue, then resolve write promise
+            //(Continuations may run meanwhile and change the queue)
+            PromiseCtx<void> ctx = queue.front().ctx;
+            queue.pop_front();
+            ctx.resolve();
+        }
+    }
+
     //Close connection
     void Socket::close()
     {   auto data = this->data;
@@ -223,8 +358,10 @@ namespace libasync
             return;
 
         //Close socket
-        if ((data->fd>=0)&&(::close(data->fd)<0))
-            throw SocketError(SocketError::Reason::CLOSE);
+        if (data->fd>=0)
+        {   this->reactor_close();
+            data->load_token.reset();
+        }
 
         //Open
         if (data->status==Status::CONNECTED)
@@ -248,7 +385,7 @@ namespace libasync
 
     //Get size of buffer used
     size_t Socket::buffer_size()
-    {   return this->data->buffer.size();
+    {   return this->data->buffer.size()+this->data->send_buffer.size();
     }
 
     //Get bytes read
@@ -262,7 +399,7 @@ namespace libasync
     }
 
     //Server socket constructor
-    ServerSocket::ServerSocket() : data(std::make_shared<ServerSocketData>())
+    ServerSocket::ServerSocket() : ServerSocket(std::make_shared<ServerSocketData>())
     {   //Create socket file descriptor
         int fd = socket(AF_INET, SOCK_STREAM, 0);
         if (fd==-1)
@@ -281,9 +418,112 @@ namespace libasync
         int enable = 1;
         if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int))<0)
             throw SocketError(SocketError::Reason::REUSEADDR);
+    }
 
-        //Register socket to reactor
-        this->reactor_register();
+    //Server socket internal constructor
+    //(Event data shares allocation and lifetime of server socket data)
+    ServerSocket::ServerSocket(ServerSocketDataRef _data)
+        : EventMixin(EventMixinDataRef(_data, &_data->events)), data(_data) {}
+
+    //Share listening address with other sockets
+    void ServerSocket::reuse_port()
+    {   int enable = 1;
+        if (setsockopt(this->data->fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(int))<0)
+            throw SocketError(SocketError::Reason::REUSEPORT);
+    }
+
+    //Prefer this socket for connections handled on given CPU
+    void ServerSocket::incoming_cpu(int cpu)
+    {
+#ifdef SO_INCOMING_CPU
+        if (setsockopt(this->data->fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(int))<0)
+            throw SocketError(SocketError::Reason::INCOMING_CPU);
+#endif
+    }
+
+    //Hand accepted connections off to worker loops
+    void ServerSocket::dispatch(std::vector<TaskLoop> workers, ServerSocket::ConnectHandler handler,
+        ServerSocket::Dispatch policy)
+    {   auto data = this->data;
+
+        data->workers = workers;
+        //Event handlers of server socket belong to this thread; workers get handler copies of their own
+        data->worker_handlers = std::make_shared<std::vector<ConnectHandler>>(workers.size(), handler);
+        data->dispatch = policy;
+        data->next_worker = 0;
+        data->worker_load.reset();
+        if (policy==Dispatch::LEAST_CONNECTIONS)
+            data->worker_load = std::make_shared<WorkerLoad>(workers.size());
+    }
+
+    //Select worker for accepted connection
+    size_t ServerSocket::select_worker(const sockaddr_in& client_addr)
+    {   auto data = this->data;
+        size_t n_workers = data->workers.size();
+
+        switch (data->dispatch)
+        {   //Worker with fewest live connections
+            case Dispatch::LEAST_CONNECTIONS:
+            {   auto& load = *data->worker_load;
+                size_t index = 0;
+
+                for (size_t i=1;i<n_workers;i++)
+                    if (load[i].load(std::memory_order_relaxed)<load[index].load(std::memory_order_relaxed))
+                        index = i;
+                return index;
+            }
+            //Hash of remote address (Same client address goes to same worker)
+            //(High bits of multiplicative hash depend on all address bits; scaled to worker count)
+            case Dispatch::HASH:
+            {   uint32_t hash = uint32_t(ntohl(client_addr.sin_addr.s_addr))*2654435761u;
+                return size_t((uint64_t(hash)*n_workers)>>32);
+            }
+            //Next worker in turn
+            default:
+            {   size_t index = data->next_worker;
+                data->next_worker = (index+1)%n_workers;
+                return index;
+            }
+        }
+    }
+
+    //Handle accepted connection
+    void ServerSocket::accepted(int client_fd, const sockaddr_in& client_addr)
+    {   auto data = this->data;
+        in_addr_t remote_addr = client_addr.sin_addr.s_addr;
+        in_port_t remote_port = client_addr.sin_port;
+
+        //No worker loops; create socket on this thread
+        //(Local address is obtained lazily)
+        if (data->workers.empty())
+        {   Socket client_sock(client_fd);
+
+            client_sock.data->remote_addr = remote_addr;
+            client_sock.data->remote_port = remote_port;
+            this->trigger("connect", client_sock);
+            return;
+        }
+
+        //Hand connection off to selected worker
+        size_t index = this->select_worker(client_addr);
+        auto worker_load = data->worker_load;
+        if (worker_load)
+            (*worker_load)[index]++;
+
+        auto worker_handlers = data->worker_handlers;
+        data->workers[index].post([=]() mutable
+        {   //Create socket on worker thread (Registered to worker reactor)
+            Socket client_sock(client_fd);
+
+            client_sock.data->remote_addr = remote_addr;
+            client_sock.data->remote_port = remote_port;
+            //Decrease worker load when socket is released
+            if (worker_load)
+                client_sock.data->load_token = std::shared_ptr<void>(nullptr, [=](void*)
+                {   (*worker_load)[index]--;
+                });
+            (*worker_handlers)[index](client_sock);
+        });
     }
 
     //Listen
@@ -308,6 +548,8 @@ namespace libasync
         data->local_port = port;
 
         data->status = Status::LISTENING;
+        //Register socket to reactor
+        this->reactor_register();
     }
 
     //Close connection
@@ -1,9 +1,72 @@
+#include <algorithm>
+#include <chrono>
 #include <libasync/taskloop.h>
 
 namespace libasync
-{   //Thread task loop data
+{   //Initial task ring capacity
+    static const size_t TASK_RING_INIT_SIZE = 64;
+    //Default lane budgets (Urgent lane must not starve I/O polling; background lane must not delay other lanes)
+    static const size_t URGENT_LANE_BUDGET = 1024;
+    static const size_t NORMAL_LANE_BUDGET = 0;
+    static const size_t BACKGROUND_LANE_BUDGET = 16;
+
+    //Thread task loop data
     thread_local TaskLoop::TaskLoopDataRef TaskLoop::thread_data;
 
+    //Task ring buffer constructor
+    TaskLoop::TaskRing::TaskRing() : slots(TASK_RING_INIT_SIZE), head(0), count(0) {}
+
+    //Append task to ring
+    void TaskLoop::TaskRing::push(TaskLoop::Task&& task)
+    {   size_t capacity = this->slots.size();
+
+        //Ring full; move tasks in order to a ring of double capacity
+        if (this->count==capacity)
+        {   std::vector<Task> new_slots(capacity*2);
+            for (size_t i=0;i<this->count;i++)
+                new_slots[i] = std::move(this->slots[(this->head+i)&(capacity-1)]);
+
+            this->slots.swap(new_slots);
+            this->head = 0;
+            capacity *= 2;
+        }
+
+        this->slots[(this->head+this->count)&(capacity-1)] = std::move(task);
+        this->count++;
+    }
+
+    //Move first task out of ring
+    //(Slot is left empty, releasing captured state of finished tasks early)
+    void TaskLoop::TaskRing::pop(TaskLoop::Task& task)
+    {   task = std::move(this->slots[this->head]);
+        this->head = (this->head+1)&(this->slots.size()-1);
+        this->count--;
+    }
+
+    //Task loop data constructor
+    TaskLoop::TaskLoopData::TaskLoopData() : n_permanent(0), current_slot(-1), n_oneshot(0), sleeping(false), running(false),
+        waker(nullptr), waker_arg(nullptr)
+    {   //Default lane budgets
+        this->lane_budgets[size_t(Priority::URGENT)] = URGENT_LANE_BUDGET;
+        this->lane_budgets[size_t(Priority::NORMAL)] = NORMAL_LANE_BUDGET;
+        this->lane_budgets[size_t(Priority::BACKGROUND)] = BACKGROUND_LANE_BUDGET;
+
+        //Posted task queue starts with a stub node
+        this->post_tail = new PostNode();
+        this->post_head.store(this->post_tail);
+    }
+
+    //Task loop data destructor
+    TaskLoop::TaskLoopData::~TaskLoopData()
+    {   //Release remaining posted tasks
+        PostNode* node = this->post_tail;
+        while (node)
+        {   PostNode* next = node->next.load();
+            delete node;
+            node = next;
+        }
+    }
+
     //Constructor
     TaskLoop::TaskLoop() : data(std::make_shared<TaskLoop::TaskLoopData>()) {}
 
@@ -20,28 +83,232 @@ namespace libasync
     }
 
     //Add a permanent task to queue
-    void TaskLoop::add(TaskLoop::Task task)
-    {   this->data->permanent_queue.push_back(task);
+    TaskLoop::TaskHandle TaskLoop::add(TaskLoop::Task task)
+    {   auto data = this->data.get();
+        uint32_t index;
+
+        //Reuse a free slot
+        //(Not while permanent tasks are running; a reused slot might still be visited this round)
+        if ((data->current_slot==-1)&&(!data->permanent_free.empty()))
+        {   index = data->permanent_free.back();
+            data->permanent_free.pop_back();
+        }
+        //Append a new slot
+        else
+        {   index = data->permanent_queue.size();
+            data->permanent_queue.emplace_back();
+        }
+
+        auto& slot = data->permanent_queue[index];
+        slot.task = std::move(task);
+        slot.paused = false;
+        data->n_permanent++;
+
+        return (TaskHandle(slot.generation)<<32)|index;
+    }
+
+    //Find permanent task slot by handle
+    TaskLoop::PermanentSlot* TaskLoop::find_slot(TaskLoop::TaskHandle handle)
+    {   auto data = this->data.get();
+        uint32_t index = handle;
+
+        if (index>=data->permanent_queue.size())
+            return nullptr;
+        auto& slot = data->permanent_queue[index];
+        if ((!slot.task)||slot.removed||(slot.generation!=uint32_t(handle>>32)))
+            return nullptr;
+        return &slot;
+    }
+
+    //Release slot of removed permanent task
+    void TaskLoop::release_slot(uint32_t index)
+    {   auto data = this->data.get();
+        auto& slot = data->permanent_queue[index];
+
+        slot.task = nullptr;
+        slot.removed = false;
+        data->permanent_free.push_back(index);
+    }
+
+    //Remove permanent task
+    bool TaskLoop::remove(TaskLoop::TaskHandle handle)
+    {   auto data = this->data.get();
+        auto slot = this->find_slot(handle);
+        if (!slot)
+            return false;
+
+        //Invalidate handle
+        slot->generation++;
+        data->n_permanent--;
+        //Task is running; release it after it returns
+        if (data->current_slot==long(uint32_t(handle)))
+            slot->removed = true;
+        else
+            this->release_slot(handle);
+        return true;
+    }
+
+    //Pause permanent task
+    bool TaskLoop::pause(TaskLoop::TaskHandle handle)
+    {   auto slot = this->find_slot(handle);
+        if (!slot)
+            return false;
+
+        slot->paused = true;
+        return true;
+    }
+
+    //Resume paused permanent task
+    bool TaskLoop::resume(TaskLoop::TaskHandle handle)
+    {   auto slot = this->find_slot(handle);
+        if (!slot)
+            return false;
+
+        slot->paused = false;
+        return true;
+    }
+
+    //Queue oneshot task to lane of given priority
+    void TaskLoop::push_oneshot(TaskLoop::Task&& task, TaskLoop::Priority priority)
+    {   auto data = this->data.get();
+
+        data->oneshot_lanes[size_t(priority)].push(std::move(task));
+        data->n_oneshot++;
     }
 
     //Add a oneshot task to queue
-    void TaskLoop::oneshot(TaskLoop::Task task)
-    {   this->data->oneshot_queue.push_back(task);
+    void TaskLoop::oneshot(TaskLoop::Task task, TaskLoop::Priority priority)
+    {   this->push_oneshot(std::move(task), priority);
+    }
+
+    //Post a oneshot task to queue from any thread
+    void TaskLoop::post(TaskLoop::Task task, TaskLoop::Priority priority)
+    {   auto data = this->data.get();
+        auto node = new PostNode();
+        node->task = std::move(task);
+        node->priority = priority;
+
+        //Link node to queue head
+        PostNode* prev = data->post_head.exchange(node);
+        prev->next.store(node, std::memory_order_release);
+        //Wake up loop only if it is blocked
+        if (data->sleeping.load()&&data->sleeping.exchange(false))
+        {   if (data->waker)
+                data->waker(data->waker_arg);
+            //Loop sleeping in "run()" without reactor
+            //(Lock ensures the flag change is not missed between its check and wait)
+            else
+            {   std::lock_guard<std::mutex> lock(data->idle_lock);
+                data->idle_cond.notify_one();
+            }
+        }
     }
 
     //Run loop once
     void TaskLoop::run_once()
-    {   for (Task task : this->data->permanent_queue)
-            task();
-        for (Task task : this->data->oneshot_queue)
-            task();
-        this->data->oneshot_queue.clear();
+    {   auto data = this->data.get();
+
+        //Run permanent tasks (Tasks added meanwhile run from next round)
+        auto& permanent_queue = data->permanent_queue;
+        for (size_t i=0, n=permanent_queue.size();i<n;i++)
+        {   auto& slot = permanent_queue[i];
+            //Free or paused
+            if ((!slot.task)||slot.paused)
+                continue;
+
+            data->current_slot = i;
+            try
+            {   slot.task();
+            }
+            catch (...)
+            {   data->current_slot = -1;
+                if (slot.removed)
+                    this->release_slot(i);
+                throw;
+            }
+            data->current_slot = -1;
+            //Removed by itself
+            if (slot.removed)
+                this->release_slot(i);
+        }
+
+        //Move tasks posted before this round to their lanes
+        //(Tasks posted meanwhile are left for next round)
+        PostNode* last = data->post_head.load(std::memory_order_acquire);
+        while (data->post_tail!=last)
+        {   PostNode* next = data->post_tail->next.load(std::memory_order_acquire);
+            //Node being linked by posting thread
+            if (!next)
+                break;
+
+            //Next node becomes stub node
+            delete data->post_tail;
+            data->post_tail = next;
+            this->push_oneshot(std::move(next->task), next->priority);
+        }
+
+        //Amount of tasks to run from each lane
+        //(Tasks queued meanwhile or over budget are left for next round)
+        size_t n_lane_tasks[N_PRIORITIES];
+        for (size_t i=0;i<N_PRIORITIES;i++)
+        {   size_t count = data->oneshot_lanes[i].count;
+            size_t budget = data->lane_budgets[i];
+            n_lane_tasks[i] = ((budget>0)&&(budget<count))?budget:count;
+        }
+
+        //Run oneshot tasks lane by lane (Each is removed before it runs)
+        Task task;
+        for (size_t i=0;i<N_PRIORITIES;i++)
+        {   auto& lane = data->oneshot_lanes[i];
+            for (size_t n=n_lane_tasks[i];n>0;n--)
+            {   lane.pop(task);
+                data->n_oneshot--;
+                task();
+            }
+        }
     }
 
-    //Run forever
+    //Run until stopped
     void TaskLoop::run()
-    {   while (true)
-            this->run_once();
+    {   auto data = this->data.get();
+
+        data->running = true;
+        while (data->running)
+        {   this->run_once();
+            //Reactor blocks while idle; otherwise sleep here
+            if (!data->waker)
+                this->idle_wait();
+        }
+    }
+
+    //Sleep until woken up or idle timeout
+    void TaskLoop::idle_wait()
+    {   auto data = this->data.get();
+
+        int timeout = this->idle_timeout();
+        if ((!data->running)||(timeout==0)||(!this->sleep_begin()))
+            return;
+
+        std::unique_lock<std::mutex> lock(data->idle_lock);
+        if (timeout<0)
+            data->idle_cond.wait(lock, [data]()
+            {   return !data->sleeping.load();
+            });
+        else
+            data->idle_cond.wait_for(lock, std::chrono::milliseconds(timeout), [data]()
+            {   return !data->sleeping.load();
+            });
+        lock.unlock();
+        this->sleep_end();
+    }
+
+    //Stop running loop
+    void TaskLoop::stop()
+    {   auto data = this->data.get();
+        //Posted to loop thread; posted task is released with loop data
+        this->post([data]()
+        {   data->running = false;
+        });
     }
 
     //Synonym for "run_once()"
@@ -49,13 +316,80 @@ namespace libasync
     {   this->run_once();
     }
 
+    //Set wakeup callback for posted tasks
+    void TaskLoop::set_waker(TaskLoop::Waker waker, void* arg)
+    {   this->data->waker = waker;
+        this->data->waker_arg = arg;
+    }
+
+    //Add idle check
+    void TaskLoop::add_idle_check(TaskLoop::IdleCheck check, void* arg)
+    {   this->data->idle_checks.push_back(std::make_pair(check, arg));
+    }
+
+    //Get milliseconds loop may sleep before running again
+    int TaskLoop::idle_timeout()
+    {   auto data = this->data.get();
+        //Oneshot or posted tasks pending
+        if ((data->n_oneshot>0)||(data->post_head.load()!=data->post_tail))
+            return 0;
+
+        //Shortest timeout of all modules
+        int timeout = -1;
+        for (auto& check : data->idle_checks)
+        {   int check_timeout = check.first(check.second);
+            if (check_timeout==0)
+                return 0;
+            else if (check_timeout>0)
+                timeout = (timeout<0)?check_timeout:std::min(timeout, check_timeout);
+        }
+        return timeout;
+    }
+
+    //Enter sleeping state before blocking
+    bool TaskLoop::sleep_begin()
+    {   auto data = this->data.get();
+        //Oneshot tasks left for next round; do not block
+        if (data->n_oneshot>0)
+            return false;
+
+        data->sleeping.store(true);
+        //Posted tasks pending; do not block
+        //(Checked after setting flag, so a concurrent post either is seen here or wakes loop up)
+        if (data->post_head.load()!=data->post_tail)
+        {   data->sleeping.store(false);
+            return false;
+        }
+        return true;
+    }
+
+    //Leave sleeping state after blocking
+    void TaskLoop::sleep_end()
+    {   this->data->sleeping.store(false);
+    }
+
     //Get amount of permanent tasks
     size_t TaskLoop::n_permanent_tasks()
-    {   return this->data->permanent_queue.size();
+    {   return this->data->n_permanent;
     }
 
     //Get amount of oneshot tasks
     size_t TaskLoop::n_oneshot_tasks()
-    {   return this->data->oneshot_queue.size();
+    {   return this->data->n_oneshot;
+    }
+
+    //Get amount of oneshot tasks of given priority
+    size_t TaskLoop::n_oneshot_tasks(TaskLoop::Priority priority)
+    {   return this->data->oneshot_lanes[size_t(priority)].count;
+    }
+
+    //Set maximum tasks run from lane of given priority per round
+    void TaskLoop::set_lane_budget(TaskLoop::Priority priority, size_t budget)
+    {   this->data->lane_budgets[size_t(priority)] = budget;
+    }
+
+    //Get maximum tasks run from lane of given priority per round
+    size_t TaskLoop::lane_budget(TaskLoop::Priority priority)
+    {   return this->data->lane_budgets[size_t(priority)];
     }
 }
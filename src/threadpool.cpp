@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <libasync/promise.h>
+#include <libasync/signals.h>
+#include <libasync/threadpool.h>
+
+namespace libasync
+{   //Initial work deque capacity
+    static const int64_t WORK_DEQUE_INIT_SIZE = 256;
+
+    //Pool of current thread
+    thread_local ThreadPoolLoop::ThreadPoolData* ThreadPoolLoop::thread_pool = nullptr;
+    //Worker index of current thread
+    thread_local size_t ThreadPoolLoop::thread_index = 0;
+
+    //Task array constructor
+    ThreadPoolLoop::WorkDeque::TaskArray::TaskArray(int64_t capacity) : mask(capacity-1),
+        slots(new std::atomic<Task*>[capacity]) {}
+
+    //Get task at given index
+    ThreadPoolLoop::Task* ThreadPoolLoop::WorkDeque::TaskArray::get(int64_t index)
+    {   return this->slots[index&this->mask].load(std::memory_order_relaxed);
+    }
+
+    //Put task at given index
+    void ThreadPoolLoop::WorkDeque::TaskArray::put(int64_t index, ThreadPoolLoop::Task* task)
+    {   this->slots[index&this->mask].store(task, std::memory_order_relaxed);
+    }
+
+    //Work deque constructor
+    ThreadPoolLoop::WorkDeque::WorkDeque() : top(0), bottom(0)
+    {   this->arrays.emplace_back(new TaskArray(WORK_DEQUE_INIT_SIZE));
+        this->array.store(this->arrays.back().get());
+    }
+
+    //Work deque destructor
+    ThreadPoolLoop::WorkDeque::~WorkDeque()
+    {   //Release tasks never run
+        auto array = this->array.load();
+        for (int64_t i=this->top.load();i<this->bottom.load();i++)
+            delete array->get(i);
+    }
+
+    //Grow task array
+    ThreadPoolLoop::WorkDeque::TaskArray* ThreadPoolLoop::WorkDeque::grow(TaskArray* old, int64_t top, int64_t bottom)
+    {   auto array = new TaskArray((old->mask+1)*2);
+        for (int64_t i=top;i<bottom;i++)
+            array->put(i, old->get(i));
+
+        this->arrays.emplace_back(array);
+        this->array.store(array, std::memory_order_release);
+        return array;
+    }
+
+    //Push task at bottom
+    void ThreadPoolLoop::WorkDeque::push(ThreadPoolLoop::Task* task)
+    {   int64_t bottom = this->bottom.load(std::memory_order_relaxed);
+        int64_t top = this->top.load(std::memory_order_acquire);
+        auto array = this->array.load(std::memory_order_relaxed);
+
+        //Array full
+        if (bottom-top>array->mask)
+            array = this->grow(array, top, bottom);
+        array->put(bottom, task);
+        //Publish task with new bottom
+        this->bottom.store(bottom+1, std::memory_order_release);
+    }
+
+    //Take task from bottom
+    ThreadPoolLoop::Task* ThreadPoolLoop::WorkDeque::take()
+    {   int64_t bottom = this->bottom.load(std::memory_order_relaxed)-1;
+        auto array = this->array.load(std::memory_order_relaxed);
+        //Reserve last task before looking at top
+        this->bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = this->top.load(std::memory_order_relaxed);
+
+        //Empty
+        if (top>bottom)
+        {   this->bottom.store(bottom+1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Task* task = array->get(bottom);
+        //Last task; race against thieves for it
+        if (top==bottom)
+        {   if (!this->top.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+            this->bottom.store(bottom+1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    //Steal task from top
+    ThreadPoolLoop::Task* ThreadPoolLoop::WorkDeque::steal()
+    {   int64_t top = this->top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t bottom = this->bottom.load(std::memory_order_acquire);
+
+        //Empty
+        if (top>=bottom)
+            return nullptr;
+
+        auto array = this->array.load(std::memory_order_acquire);
+        Task* task = array->get(top);
+        //Lost race against owner or another thief
+        if (!this->top.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+
+    //Check if deque looks empty
+    bool ThreadPoolLoop::WorkDeque::empty()
+    {   return this->top.load()>=this->bottom.load();
+    }
+
+    //Stop threads after all handles are released
+    void ThreadPoolLoop::ThreadPoolRelease::operator()(ThreadPoolLoop::ThreadPoolData* data)
+    {   data->running.store(false);
+        {   std::lock_guard<std::mutex> guard(data->lock);
+            data->wake_seq++;
+            data->cond.notify_all();
+        }
+
+        for (auto& thread : data->threads)
+            //(Released from a thread of this pool; cannot wait for itself, and its own reference keeps data alive)
+            if (thread.get_id()==std::this_thread::get_id())
+                thread.detach();
+            else if (thread.joinable())
+                thread.join();
+    }
+
+    //Find a task to run
+    ThreadPoolLoop::Task* ThreadPoolLoop::find_task(ThreadPoolLoop::ThreadPoolData* data, size_t index)
+    {   //Own deque (Newest task first; its data is likely still in cache)
+        Task* task = data->deques[index]->take();
+        if (task)
+            return task;
+
+        //Tasks posted from other threads
+        if (data->n_injected.load()>0)
+        {   std::lock_guard<std::mutex> guard(data->lock);
+            if (!data->inject_queue.empty())
+            {   task = new Task(std::move(data->inject_queue.front()));
+                data->inject_queue.pop_front();
+                data->n_injected--;
+                return task;
+            }
+        }
+
+        //Steal oldest task of other threads
+        size_t n_threads = data->deques.size();
+        for (size_t i=1;i<n_threads;i++)
+        {   task = data->deques[(index+i)%n_threads]->steal();
+            if (task)
+                return task;
+        }
+        return nullptr;
+    }
+
+    //Wake up sleeping threads if any
+    void ThreadPoolLoop::wakeup(ThreadPoolLoop::ThreadPoolData* data, bool all)
+    {   //Pairs with sleeping thread counting itself before checking queues again
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (data->n_sleeping.load()==0)
+            return;
+
+        std::lock_guard<std::mutex> guard(data->lock);
+        data->wake_seq++;
+        if (all)
+            data->cond.notify_all();
+        else
+            data->cond.notify_one();
+    }
+
+    //Wakeup callback of worker task loops
+    void ThreadPoolLoop::loop_wakeup(void* arg)
+    {   //(Posting thread does not know which worker owns the loop)
+        wakeup(static_cast<ThreadPoolData*>(arg), true);
+    }
+
+    //Thread main function
+    void ThreadPoolLoop::thread_main(ThreadPoolLoop::ThreadPoolDataRef data_ref, size_t index)
+    {   //(Reference is held until thread exits, since a task may release the last handle)
+        auto data = data_ref.get();
+        ThreadPoolLoop::thread_pool = data;
+        ThreadPoolLoop::thread_index = index;
+
+        //Task loop of worker runs promise callbacks and tasks posted to it
+        promise_init();
+        TaskLoop loop = TaskLoop::thread_loop();
+        loop.set_waker(loop_wakeup, data);
+
+        while (data->running.load())
+        {   std::unique_ptr<Task> task(find_task(data, index));
+            if (task)
+            {   (*task)();
+                task.reset();
+                //Continuations scheduled by task
+                if (loop.idle_timeout()==0)
+                    loop.run_once();
+                continue;
+            }
+            if (loop.idle_timeout()==0)
+            {   loop.run_once();
+                continue;
+            }
+
+            //Count as sleeping, then look for work again
+            //(A concurrent post either is seen here or wakes this thread up)
+            std::unique_lock<std::mutex> guard(data->lock);
+            uint64_t seq = data->wake_seq;
+            data->n_sleeping++;
+
+            bool idle = data->running.load()&&data->inject_queue.empty();
+            for (size_t i=0;idle&&(i<data->deques.size());i++)
+                idle = data->deques[i]->empty();
+            if (idle&&loop.sleep_begin())
+            {   data->cond.wait(guard, [=]()
+                {   return (data->wake_seq!=seq)||(!data->running.load());
+                });
+                loop.sleep_end();
+            }
+            data->n_sleeping--;
+        }
+
+        ThreadPoolLoop::thread_pool = nullptr;
+    }
+
+    //Constructor
+    ThreadPoolLoop::ThreadPoolLoop(size_t n_threads)
+    {   auto data_ref = std::make_shared<ThreadPoolData>();
+        auto data = data_ref.get();
+        //Handles share a reference that stops threads when released
+        this->data = ThreadPoolDataRef(data, ThreadPoolRelease{data_ref});
+
+        if (n_threads==0)
+            n_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        for (size_t i=0;i<n_threads;i++)
+            data->deques.emplace_back(new WorkDeque());
+        //(Threads start with asynchronous signals blocked, so signals handled through a reactor never reach them)
+        signals::BlockScope block_scope;
+        for (size_t i=0;i<n_threads;i++)
+            data->threads.emplace_back(thread_main, data_ref, i);
+    }
+
+    //Post a oneshot task from any thread
+    void ThreadPoolLoop::post(ThreadPoolLoop::Task task)
+    {   auto data = this->data.get();
+
+        //Worker of this pool; push to own deque
+        if (ThreadPoolLoop::thread_pool==data)
+            data->deques[ThreadPoolLoop::thread_index]->push(new Task(std::move(task)));
+        //Other thread; push to inject queue
+        else
+        {   std::lock_guard<std::mutex> guard(data->lock);
+            data->inject_queue.push_back(std::move(task));
+            data->n_injected++;
+        }
+
+        wakeup(data);
+    }
+
+    //Get amount of threads
+    size_t ThreadPoolLoop::size()
+    {   return this->data->threads.size();
+    }
+
+    //Get worker index of current thread
+    long ThreadPoolLoop::worker_index()
+    {   return (ThreadPoolLoop::thread_pool==this->data.get())?long(ThreadPoolLoop::thread_index):-1;
+    }
+
+    //Stop all threads
+    void ThreadPoolLoop::stop()
+    {   auto data = this->data.get();
+
+        data->running.store(false);
+        std::lock_guard<std::mutex> guard(data->lock);
+        data->wake_seq++;
+        data->cond.notify_all();
+    }
+
+    //Wait for all threads to exit
+    void ThreadPoolLoop::join()
+    {   for (auto& thread : this->data->threads)
+            if (thread.joinable())
+                thread.join();
+    }
+}
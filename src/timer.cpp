@@ -0,0 +1,330 @@
+#include <limits.h>
+#include <algorithm>
+#include <libasync/timer.h>
+
+namespace libasync
+{   namespace timer
+    {   //Slot of timers being fired
+        static const int FIRING_SLOT = WHEEL_LEVELS*WHEEL_SIZE;
+
+        //Hierarchical timing wheel type
+        struct TimerWheel
+        {   //Time origin
+            Deadline origin;
+            //Next tick to process
+            uint64_t tick;
+            //Amount of scheduled timers
+            size_t n_timers;
+
+            //Slot occupancy bitmaps
+            uint64_t occupied[WHEEL_LEVELS];
+            //Slot lists (Sentinel nodes)
+            TimerLink slots[WHEEL_LEVELS][WHEEL_SIZE];
+
+            //Constructor
+            TimerWheel() : origin(TimerClock::now()), tick(0), n_timers(0)
+            {   for (unsigned level=0;level<WHEEL_LEVELS;level++)
+                {   this->occupied[level] = 0;
+                    for (unsigned index=0;index<WHEEL_SIZE;index++)
+                        this->slots[level][index].prev = this->slots[level][index].next = &this->slots[level][index];
+                }
+            }
+
+            //Convert deadline to tick (Rounded up)
+            uint64_t to_tick(Deadline deadline)
+            {   auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline-this->origin).count();
+                return (delta<=0)?0:(delta+999999)/1000000;
+            }
+
+            //Get current tick (Rounded down)
+            uint64_t now_tick()
+            {   auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(TimerClock::now()-this->origin).count();
+                return (delta<=0)?0:delta;
+            }
+
+            //Link timer into list
+            static void link(TimerLink* list, TimerLink* node)
+            {   node->prev = list->prev;
+                node->next = list;
+                list->prev->next = node;
+                list->prev = node;
+            }
+
+            //Unlink timer from list
+            static void unlink(TimerLink* node)
+            {   node->prev->next = node->next;
+                node->next->prev = node->prev;
+            }
+
+            //Move all timers from one list to another
+            static void splice(TimerLink* from, TimerLink* to)
+            {   to->prev = to->next = to;
+                if (from->next==from)
+                    return;
+
+                to->next = from->next;
+                to->prev = from->prev;
+                to->next->prev = to;
+                to->prev->next = to;
+                from->prev = from->next = from;
+            }
+
+            //Insert timer into wheel
+            void insert(Timer::TimerData* node)
+            {   uint64_t expiry = node->expiry;
+                //Already expired; fire at next tick
+                if (expiry<this->tick)
+                    expiry = this->tick;
+                //Beyond wheel range; park in top level and cascade again later
+                uint64_t delta = expiry-this->tick;
+                if (delta>=(uint64_t(1)<<(WHEEL_BITS*WHEEL_LEVELS)))
+                {   delta = (uint64_t(1)<<(WHEEL_BITS*WHEEL_LEVELS))-1;
+                    expiry = this->tick+delta;
+                }
+
+                //Find level and slot
+                unsigned level = 0;
+                while (delta>=(uint64_t(1)<<(WHEEL_BITS*(level+1))))
+                    level++;
+                unsigned index = (expiry>>(WHEEL_BITS*level))&(WHEEL_SIZE-1);
+
+                //Add to slot
+                link(&this->slots[level][index], node);
+                this->occupied[level] |= uint64_t(1)<<index;
+                node->slot = level*WHEEL_SIZE+index;
+            }
+
+            //Remove timer from wheel
+            void remove(Timer::TimerData* node)
+            {   unlink(node);
+                //Update occupancy bitmap
+                if (node->slot!=FIRING_SLOT)
+                {   unsigned level = node->slot/WHEEL_SIZE;
+                    unsigned index = node->slot%WHEEL_SIZE;
+                    TimerLink* list = &this->slots[level][index];
+
+                    if (list->next==list)
+                        this->occupied[level] &= ~(uint64_t(1)<<index);
+                }
+
+                node->slot = -1;
+                this->n_timers--;
+            }
+
+            //Move timers in upper level slot to lower levels
+            void cascade(unsigned level, unsigned index)
+            {   TimerLink list;
+
+                if (!(this->occupied[level]&(uint64_t(1)<<index)))
+                    return;
+                splice(&this->slots[level][index], &list);
+                this->occupied[level] &= ~(uint64_t(1)<<index);
+
+                while (list.next!=&list)
+                {   auto node = static_cast<Timer::TimerData*>(list.next);
+                    unlink(node);
+                    this->insert(node);
+                }
+            }
+
+            //Fire all timers in given list
+            void fire(TimerLink* list)
+            {   while (list->next!=list)
+                {   auto node = static_cast<Timer::TimerData*>(list->next);
+                    unlink(node);
+                    node->slot = -1;
+                    this->n_timers--;
+
+                    //Release self reference and call back
+                    auto data = node->self;
+                    node->self.reset();
+                    try
+                    {   data->callback();
+                    }
+                    //Keep remaining timers for next tick
+                    catch (...)
+                    {   unsigned index = this->tick&(WHEEL_SIZE-1);
+                        while (list->next!=list)
+                        {   auto rest = static_cast<Timer::TimerData*>(list->next);
+                            unlink(rest);
+                            link(&this->slots[0][index], rest);
+                            rest->slot = index;
+                            this->occupied[0] |= uint64_t(1)<<index;
+                        }
+                        throw;
+                    }
+                }
+            }
+
+            //Process expired ticks
+            void advance()
+            {   uint64_t now = this->now_tick();
+
+                while (this->tick<=now)
+                {   //No timer pending; skip to current time
+                    if (this->n_timers==0)
+                    {   this->tick = now+1;
+                        break;
+                    }
+                    //Nothing in lowest level; skip to next cascade
+                    if (this->occupied[0]==0)
+                    {   uint64_t next_tick = (this->tick+WHEEL_SIZE-1)&~uint64_t(WHEEL_SIZE-1);
+                        if (next_tick>now)
+                        {   this->tick = now+1;
+                            break;
+                        }
+                        this->tick = next_tick;
+                    }
+
+                    //Cascade upper levels when lower level wraps
+                    unsigned index = this->tick&(WHEEL_SIZE-1);
+                    if (index==0)
+                        for (unsigned level=1;level<WHEEL_LEVELS;level++)
+                        {   unsigned upper_index = (this->tick>>(WHEEL_BITS*level))&(WHEEL_SIZE-1);
+                            this->cascade(level, upper_index);
+                            if (upper_index!=0)
+                                break;
+                        }
+                    this->tick++;
+
+                    //Fire timers in current slot
+                    //(Timers added by callbacks go to later slots)
+                    if (this->occupied[0]&(uint64_t(1)<<index))
+                    {   TimerLink list;
+                        splice(&this->slots[0][index], &list);
+                        this->occupied[0] &= ~(uint64_t(1)<<index);
+
+                        //Mark timers as being fired
+                        for (TimerLink* node=list.next;node!=&list;node=node->next)
+                            static_cast<Timer::TimerData*>(node)->slot = FIRING_SLOT;
+                        this->fire(&list);
+                    }
+                }
+            }
+
+            //Get tick of next timer event
+            uint64_t next_tick()
+            {   uint64_t result = UINT64_MAX;
+
+                for (unsigned level=0;level<WHEEL_LEVELS;level++)
+                {   uint64_t bits = this->occupied[level];
+                    if (!bits)
+                        continue;
+
+                    //Rotate bitmap so that bit 0 is current slot
+                    unsigned shift = WHEEL_BITS*level;
+                    uint64_t base = this->tick>>shift;
+                    unsigned current = base&(WHEEL_SIZE-1);
+                    uint64_t rotated = current?((bits>>current)|(bits<<(WHEEL_SIZE-current))):bits;
+
+                    //Lowest level: timers fire at their slot
+                    if (level==0)
+                    {   result = std::min<uint64_t>(result, this->tick+__builtin_ctzll(rotated));
+                        continue;
+                    }
+                    //Upper levels: timers cascade when lower level wraps to their slot
+                    //(Current slot of an upper level holds timers of next round)
+                    if (rotated&1)
+                    {   uint64_t next_tick = base<<shift;
+                        if (next_tick<this->tick)
+                            next_tick += uint64_t(WHEEL_SIZE)<<shift;
+                        result = std::min(result, next_tick);
+                    }
+                    if (rotated&~uint64_t(1))
+                        result = std::min(result, (base+__builtin_ctzll(rotated&~uint64_t(1)))<<shift);
+                }
+
+                return result;
+            }
+        };
+
+        //Timing wheel of current thread
+        thread_local TimerWheel* timer_wheel = nullptr;
+
+        //Get milliseconds until next timer event
+        int next_timeout()
+        {   if ((!timer_wheel)||(timer_wheel->n_timers==0))
+                return -1;
+
+            uint64_t next_tick = timer_wheel->next_tick();
+            uint64_t now = timer_wheel->now_tick();
+            //Already expired
+            if (next_tick<=now)
+                return 0;
+            return std::min<uint64_t>(next_tick-now, INT_MAX);
+        }
+
+        //Idle check of timer module
+        static int timer_idle(void* arg)
+        {   return next_timeout();
+        }
+
+        //Timer task
+        void timer_task()
+        {   timer_wheel->advance();
+        }
+
+        //Sleep for given milliseconds
+        Promise<void> sleep(unsigned long ms)
+        {   return at(TimerClock::now()+std::chrono::milliseconds(ms));
+        }
+
+        //Sleep until given deadline
+        Promise<void> at(Deadline deadline)
+        {   return Promise<void>([=](PromiseCtx<void> ctx)
+            {   Timer(deadline, [=]() mutable
+                {   ctx.resolve();
+                });
+            });
+        }
+    }
+
+    //Initialize timer module for current thread
+    void timer_init()
+    {   //Initialize timing wheel
+        timer::timer_wheel = new timer::TimerWheel();
+        //Add timer task and idle check to task loop
+        TaskLoop::thread_loop().add(timer::timer_task);
+        TaskLoop::thread_loop().add_idle_check(timer::timer_idle, nullptr);
+    }
+
+    //Construct a timer expiring at given deadline
+    Timer::Timer(Deadline deadline, Callback callback) : data(std::make_shared<TimerData>())
+    {   auto wheel = timer::timer_wheel;
+        auto data = this->data;
+
+        data->deadline = deadline;
+        data->expiry = wheel->to_tick(deadline);
+        data->callback = std::move(callback);
+        //Schedule timer
+        data->self = data;
+        wheel->insert(data.get());
+        wheel->n_timers++;
+    }
+
+    //Construct a timer expiring after given milliseconds
+    Timer::Timer(unsigned long ms, Callback callback)
+        : Timer(TimerClock::now()+std::chrono::milliseconds(ms), std::move(callback)) {}
+
+    //Cancel timer
+    bool Timer::cancel()
+    {   auto data = this->data;
+        //Not scheduled
+        if (data->slot==-1)
+            return false;
+
+        timer::timer_wheel->remove(data.get());
+        data->self.reset();
+        return true;
+    }
+
+    //Check if timer is still pending
+    bool Timer::pending()
+    {   return this->data->slot!=-1;
+    }
+
+    //Get deadline
+    Deadline Timer::deadline()
+    {   return this->data->deadline;
+    }
+}
@@ -0,0 +1,52 @@
+#include <libasync/watcher.h>
+
+namespace libasync
+{   //Constructor
+    FdWatcher::FdWatcher(int fd, bool readable, bool writable, FdWatcher::Mode mode)
+        : FdWatcher(std::make_shared<FdWatcherData>())
+    {   auto data = this->data;
+
+        data->fd = fd;
+        data->mode = mode;
+        data->readable = readable;
+        data->writable = writable;
+        //Register watcher to reactor
+        this->reactor_register();
+        data->active = true;
+    }
+
+    //Internal constructor
+    //(Event data shares allocation and lifetime of watcher data)
+    FdWatcher::FdWatcher(FdWatcherDataRef _data)
+        : EventMixin(EventMixinDataRef(_data, &_data->events)), data(_data) {}
+
+    //Change watched events
+    void FdWatcher::watch(bool readable, bool writable)
+    {   auto data = this->data;
+
+        data->readable = readable;
+        data->writable = writable;
+        if (data->active)
+            this->reactor_update();
+    }
+
+    //Stop watching
+    void FdWatcher::stop()
+    {   auto data = this->data;
+        if (!data->active)
+            return;
+
+        data->active = false;
+        this->reactor_stop();
+    }
+
+    //Get watched file descriptor
+    int FdWatcher::fd()
+    {   return this->data->fd;
+    }
+
+    //Check if watcher is active
+    bool FdWatcher::active()
+    {   return this->data->active;
+    }
+}